@@ -0,0 +1,298 @@
+#include "MockGenAIServer.h"
+#include <QHostAddress>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPointer>
+#include <QRegularExpression>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QUrlQuery>
+#include <memory>
+
+namespace {
+const QByteArray kPathPrefix = "/genai";
+
+QByteArray statusLine(int status)
+{
+    switch (status) {
+    case 200: return "HTTP/1.1 200 OK\r\n";
+    case 400: return "HTTP/1.1 400 Bad Request\r\n";
+    case 404: return "HTTP/1.1 404 Not Found\r\n";
+    default:  return "HTTP/1.1 503 Service Unavailable\r\n";
+    }
+}
+
+QByteArray problemsResponse(int count, bool multipleChoice)
+{
+    QJsonArray problems;
+    for (int i = 0; i < count; ++i) {
+        int a = 3 + i;
+        int b = 7 + 2 * i;
+        QJsonObject problem;
+        problem["statement"] = QString("Solve for x: %1x + %2 = %3").arg(a).arg(b).arg(a * 4 + b);
+        if (multipleChoice) {
+            problem["choices"] = QJsonArray{"x = 2", "x = 4", "x = 6", "x = 8"};
+            problem["correct"] = "B";
+        }
+        problems.append(problem);
+    }
+    QJsonObject root{{"schema", "pipino.problems/1"}, {"problems", problems}};
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+QByteArray gradeResponse()
+{
+    QJsonObject root{
+        {"schema", "pipino.grade/1"},
+        {"grade", "B"},
+        {"feedback", "Correct method, but the subtraction in step 2 needs another look."}
+    };
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+}
+
+MockGenAIServer::MockGenAIServer(const Config& cfg, QObject *parent)
+    : QObject(parent)
+    , config(cfg)
+    , random(cfg.seed)
+{
+    connect(&server, &QTcpServer::newConnection, this, &MockGenAIServer::onNewConnection);
+}
+
+bool MockGenAIServer::listen(quint16 port)
+{
+    return server.listen(QHostAddress::LocalHost, port);
+}
+
+quint16 MockGenAIServer::port() const
+{
+    return server.serverPort();
+}
+
+QString MockGenAIServer::baseUrl() const
+{
+    return QString("http://127.0.0.1:%1%2").arg(port()).arg(QString::fromLatin1(kPathPrefix));
+}
+
+void MockGenAIServer::setCannedResponse(const QByteArray& endpoint, const QByteArray& body)
+{
+    cannedResponses.insert(endpoint, body);
+}
+
+void MockGenAIServer::onNewConnection()
+{
+    while (QTcpSocket *socket = server.nextPendingConnection()) {
+        connections.insert(socket, Connection());
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+            connections[socket].buffer.append(socket->readAll());
+            processBuffer(socket);
+        });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            connections.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void MockGenAIServer::processBuffer(QTcpSocket *socket)
+{
+    auto it = connections.find(socket);
+    if (it == connections.end() || it->busy) {
+        return;
+    }
+
+    QByteArray& buffer = it->buffer;
+    int headerEnd = buffer.indexOf("\r\n\r\n");
+    if (headerEnd < 0) {
+        return;
+    }
+
+    const QList<QByteArray> lines = buffer.left(headerEnd).split('\n');
+    const QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+    if (requestLine.size() < 2) {
+        socket->disconnectFromHost();
+        return;
+    }
+
+    qsizetype contentLength = 0;
+    for (int i = 1; i < lines.size(); ++i) {
+        int colon = lines[i].indexOf(':');
+        if (colon > 0 && lines[i].left(colon).trimmed().compare("content-length", Qt::CaseInsensitive) == 0) {
+            contentLength = lines[i].mid(colon + 1).trimmed().toLongLong();
+        }
+    }
+
+    qsizetype requestSize = headerEnd + 4 + contentLength;
+    if (buffer.size() < requestSize) {
+        return; // Body still arriving
+    }
+
+    Request request;
+    request.method = requestLine[0];
+    QByteArray target = requestLine[1];
+    int question = target.indexOf('?');
+    request.path = question < 0 ? target : target.left(question);
+    request.query = question < 0 ? QByteArray() : target.mid(question + 1);
+    request.body = buffer.mid(headerEnd + 4, contentLength);
+    buffer.remove(0, requestSize);
+
+    it->busy = true;
+    handleRequest(socket, request);
+}
+
+void MockGenAIServer::handleRequest(QTcpSocket *socket, const Request& request)
+{
+    QByteArray endpoint = request.path.startsWith(kPathPrefix) ? request.path.mid(kPathPrefix.size()) : request.path;
+
+    ++counters.requests;
+    ++counters.perEndpoint[endpoint];
+
+    QString message;
+    if (request.method == "GET") {
+        QUrlQuery query(QString::fromUtf8(request.query));
+        message = query.queryItemValue("message", QUrl::FullyDecoded);
+    } else {
+        message = QString::fromUtf8(request.body);
+    }
+
+    bool known = endpoint == "/prompt" || endpoint == "/chat" || endpoint == "/stream" || endpoint == "/ocr";
+    bool rejected = known && endpoint == "/chat" && !isValidChatBody(request.body);
+    if (rejected) {
+        ++counters.rejected;
+    }
+    bool fail = known && !rejected && config.failureRate > 0.0 && random.generateDouble() < config.failureRate;
+    if (fail) {
+        ++counters.injectedFailures;
+    }
+
+    QByteArray body = known ? responseFor(endpoint, message) : QByteArray("Not found");
+
+    QPointer<QTcpSocket> guard(socket);
+    QTimer::singleShot(nextDelayMs(), this, [this, guard, endpoint, known, rejected, fail, body]() {
+        if (!guard) return;
+        if (!known) {
+            writeResponse(guard, 404, "text/plain", body);
+        } else if (rejected) {
+            writeResponse(guard, 400, "text/plain", "messages must be MessageDto {type, text} starting with a Human message");
+        } else if (fail) {
+            writeResponse(guard, 503, "text/plain", "Injected failure");
+        } else if (endpoint == "/stream") {
+            writeStream(guard, body);
+            return; // Finishes itself once the last piece is written
+        } else {
+            writeResponse(guard, 200, "application/json", body);
+        }
+        finishRequest(guard);
+    });
+}
+
+void MockGenAIServer::finishRequest(QTcpSocket *socket)
+{
+    auto it = connections.find(socket);
+    if (it == connections.end()) {
+        return;
+    }
+    it->busy = false;
+    processBuffer(socket); // A request may have queued up behind this one
+}
+
+void MockGenAIServer::writeResponse(QTcpSocket *socket, int status, const QByteArray& contentType,
+                                    const QByteArray& body)
+{
+    QByteArray response = statusLine(status);
+    response += "Content-Type: " + contentType + "\r\n";
+    response += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+    response += "Connection: keep-alive\r\n\r\n";
+    response += body;
+    socket->write(response);
+}
+
+void MockGenAIServer::writeStream(QTcpSocket *socket, const QByteArray& body)
+{
+    socket->write(statusLine(200) +
+                  "Content-Type: text/plain; charset=utf-8\r\n"
+                  "Transfer-Encoding: chunked\r\n"
+                  "Connection: keep-alive\r\n\r\n");
+
+    // Split on byte boundaries on purpose: a multi-byte character may straddle two pieces
+    const int pieces = qMax(1, config.streamChunks);
+    const qsizetype pieceSize = qMax<qsizetype>(1, (body.size() + pieces - 1) / pieces);
+
+    QPointer<QTcpSocket> guard(socket);
+    auto offset = std::make_shared<qsizetype>(0);
+    auto writeNext = std::make_shared<std::function<void()>>();
+    *writeNext = [this, guard, body, pieceSize, offset, writeNext]() {
+        if (!guard) {
+            *writeNext = nullptr; // Break the self-reference
+            return;
+        }
+        if (*offset >= body.size()) {
+            guard->write("0\r\n\r\n");
+            *writeNext = nullptr;
+            finishRequest(guard);
+            return;
+        }
+        QByteArray piece = body.mid(*offset, pieceSize);
+        *offset += piece.size();
+        guard->write(QByteArray::number(piece.size(), 16) + "\r\n" + piece + "\r\n");
+        QTimer::singleShot(config.streamChunkDelayMs, this, *writeNext);
+    };
+    (*writeNext)();
+}
+
+QByteArray MockGenAIServer::responseFor(const QByteArray& endpoint, const QString& message) const
+{
+    auto canned = cannedResponses.constFind(endpoint);
+    if (canned != cannedResponses.constEnd()) {
+        return canned.value();
+    }
+
+    if (endpoint == "/ocr") {
+        return "2x + 5 = 13\n2x = 13 - 5\n2x = 8\nx = 4";
+    }
+    if (endpoint == "/stream") {
+        return "Let's go through it step by step. Subtracting 5 from both sides gives 2x = 8, "
+               "and dividing by 2 gives x = 4. Your first step was right; in the second you "
+               "added instead of subtracting, which is why the final answer came out as 9. "
+               "Check each step by substituting your answer back into the original equation – "
+               "4 · 2 + 5 = 13 ✓.";
+    }
+    if (message.contains("pipino.grade/1")) {
+        return gradeResponse();
+    }
+    if (message.contains("pipino.problems/1")) {
+        static const QRegularExpression countPattern("Generate (\\d+) different");
+        QRegularExpressionMatch match = countPattern.match(message);
+        int count = match.hasMatch() ? qBound(1, match.captured(1).toInt(), 20) : 1;
+        return problemsResponse(count, message.contains("multiple choice"));
+    }
+    return "This is a canned answer from the mock GenAI server.";
+}
+
+bool MockGenAIServer::isValidChatBody(const QByteArray& body)
+{
+    QJsonParseError error;
+    QJsonDocument doc = QJsonDocument::fromJson(body, &error);
+    if (error.error != QJsonParseError::NoError || !doc.isObject()) {
+        return false;
+    }
+
+    const QJsonArray messages = doc.object().value("messages").toArray();
+    if (messages.isEmpty()) {
+        return false;
+    }
+    for (const QJsonValue& value : messages) {
+        QJsonObject message = value.toObject();
+        if (!message.value("type").isString() || !message.value("text").isString()) {
+            return false;
+        }
+    }
+    return messages.first().toObject().value("type").toString() == "Human";
+}
+
+int MockGenAIServer::nextDelayMs()
+{
+    int jitter = config.jitterMs > 0 ? random.bounded(-config.jitterMs, config.jitterMs + 1) : 0;
+    return qMax(0, config.latencyMs + jitter);
+}
@@ -0,0 +1,101 @@
+#ifndef MOCKGENAISERVER_H
+#define MOCKGENAISERVER_H
+
+#include <QObject>
+#include <QTcpServer>
+#include <QHash>
+#include <QByteArray>
+#include <QRandomGenerator>
+
+class QTcpSocket;
+
+/**
+ * @brief Local stand-in for the GenAI backend (/genai/prompt, /chat, /stream, /ocr)
+ *
+ * A minimal HTTP/1.1 server on QTcpServer with keep-alive, so AIService and the
+ * classes built on it can be exercised without the bootstrap API and Bedrock
+ * behind it. Every response is delayed by latency +/- jitter, a configurable share
+ * of requests fail with 503, and /stream answers with chunked transfer encoding.
+ * /chat bodies are checked like the backend's MessageDto validation ({"messages":
+ * [{"type": "Human", "text": "..."}, ...]}) and rejected with 400 otherwise.
+ *
+ * Responses are canned but follow the same contracts as the real backend: prompts
+ * asking for the pipino.problems/1 or pipino.grade/1 schema get a matching JSON
+ * object (with as many problems as the prompt asks for), so the parsing path is
+ * measured too.
+ */
+class MockGenAIServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Config {
+        int latencyMs = 150;           // Mean delay before the response starts
+        int jitterMs = 50;             // Uniform +/- spread around latencyMs
+        double failureRate = 0.0;      // Share of requests answered with 503, 0..1
+        int streamChunks = 8;          // Pieces a /stream answer is split into
+        int streamChunkDelayMs = 25;   // Gap between stream pieces
+        quint32 seed = 1;              // Fixed seed so runs are comparable
+    };
+
+    struct Stats {
+        quint64 requests = 0;
+        quint64 injectedFailures = 0;
+        quint64 rejected = 0;          // Malformed bodies answered with 400
+        QHash<QByteArray, quint64> perEndpoint;
+    };
+
+    explicit MockGenAIServer(const Config& config, QObject *parent = nullptr);
+
+    /**
+     * @brief Start listening on 127.0.0.1; port 0 picks a free one
+     */
+    bool listen(quint16 port = 0);
+    quint16 port() const;
+
+    /**
+     * @brief Base URL to hand to AIService::setDefaultBaseUrl()
+     */
+    QString baseUrl() const;
+
+    /**
+     * @brief Replace the generated answer for an endpoint ("/prompt", "/chat", "/stream", "/ocr")
+     */
+    void setCannedResponse(const QByteArray& endpoint, const QByteArray& body);
+
+    Stats stats() const { return counters; }
+
+private slots:
+    void onNewConnection();
+
+private:
+    struct Connection {
+        QByteArray buffer;
+        bool busy = false;   // A response is pending; later requests wait in the buffer
+    };
+
+    struct Request {
+        QByteArray method;
+        QByteArray path;
+        QByteArray query;
+        QByteArray body;
+    };
+
+    QTcpServer server;
+    Config config;
+    QRandomGenerator random;
+    QHash<QTcpSocket*, Connection> connections;
+    QHash<QByteArray, QByteArray> cannedResponses;
+    Stats counters;
+
+    void processBuffer(QTcpSocket *socket);
+    void handleRequest(QTcpSocket *socket, const Request& request);
+    void finishRequest(QTcpSocket *socket);
+    void writeResponse(QTcpSocket *socket, int status, const QByteArray& contentType, const QByteArray& body);
+    void writeStream(QTcpSocket *socket, const QByteArray& body);
+    QByteArray responseFor(const QByteArray& endpoint, const QString& message) const;
+    static bool isValidChatBody(const QByteArray& body);
+    int nextDelayMs();
+};
+
+#endif // MOCKGENAISERVER_H
@@ -0,0 +1,355 @@
+// OCR throughput and accuracy benchmark.
+//
+// Reads a manifest of images with their expected text (Assets/ocr_manifest.json by
+// default) and reports, for the current preprocessing settings:
+//   - per-image latency and character error rate through OcrScanner (one engine),
+//   - pages/sec through OcrEnginePool at 1..N engines,
+//   - the process's peak resident set size after each phase.
+//
+//   ocr_bench --iterations 5 --max-threads 8 --mode both
+//   ocr_bench --no-preprocess --manifest my_photos/manifest.json
+//
+// Manifest format: {"images": [{"file": "test1.png", "expected": "2+5=7"}, ...]}.
+// Paths are relative to the manifest. "expected": null marks images without
+// reference text; they are timed but left out of the error rate.
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+#include <algorithm>
+#include <cstdio>
+#include "OcrEnginePool.h"
+#include "OcrPreprocessor.h"
+#include "OcrScanner.h"
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+struct ManifestEntry {
+    QString name;
+    QString path;
+    QString expected;
+    bool hasExpected = false;
+};
+
+struct ImageResult {
+    QVector<double> latenciesMs;
+    qsizetype referenceChars = 0;
+    qsizetype edits = 0;
+    bool failed = false;
+};
+
+bool loadManifest(const QString& manifestPath, QVector<ManifestEntry>& entries)
+{
+    QFile file(manifestPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        std::fprintf(stderr, "Could not open manifest %s\n", qPrintable(manifestPath));
+        return false;
+    }
+
+    QJsonParseError error;
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &error);
+    if (error.error != QJsonParseError::NoError || !doc.isObject()) {
+        std::fprintf(stderr, "Invalid manifest %s: %s\n", qPrintable(manifestPath), qPrintable(error.errorString()));
+        return false;
+    }
+
+    const QDir baseDir = QFileInfo(manifestPath).absoluteDir();
+    const QJsonArray images = doc.object().value("images").toArray();
+    for (const QJsonValue& value : images) {
+        QJsonObject image = value.toObject();
+        ManifestEntry entry;
+        entry.name = image.value("file").toString();
+        if (entry.name.isEmpty()) {
+            continue;
+        }
+        entry.path = baseDir.filePath(entry.name);
+        entry.hasExpected = image.value("expected").isString();
+        entry.expected = image.value("expected").toString();
+        if (!QFileInfo::exists(entry.path)) {
+            std::fprintf(stderr, "warning: %s is listed in the manifest but missing\n", qPrintable(entry.path));
+        }
+        entries.append(entry);
+    }
+
+    return !entries.isEmpty();
+}
+
+bool isOcrError(const QString& text)
+{
+    return text.startsWith("OCR Error:");
+}
+
+// Layout is not part of the score: line breaks and spacing in maths are arbitrary, so
+// all whitespace is dropped. Compatibility forms are folded (² -> 2) and the various
+// dashes become '-', which is what a student would have typed anyway.
+QString normalizeForScoring(const QString& text)
+{
+    const QString folded = text.normalized(QString::NormalizationForm_KC);
+    QString out;
+    out.reserve(folded.size());
+    for (QChar c : folded) {
+        if (c.isSpace()) {
+            continue;
+        }
+        if (c == QChar(0x2212) || c == QChar(0x2013) || c == QChar(0x2014)) {
+            c = QLatin1Char('-');
+        }
+        out.append(c);
+    }
+    return out;
+}
+
+// Levenshtein distance over UTF-16 code units, two rows
+qsizetype editDistance(const QString& a, const QString& b)
+{
+    QVector<qsizetype> previous(b.size() + 1);
+    QVector<qsizetype> current(b.size() + 1);
+    for (qsizetype j = 0; j <= b.size(); ++j) {
+        previous[j] = j;
+    }
+    for (qsizetype i = 1; i <= a.size(); ++i) {
+        current[0] = i;
+        for (qsizetype j = 1; j <= b.size(); ++j) {
+            qsizetype substitution = previous[j - 1] + (a[i - 1] == b[j - 1] ? 0 : 1);
+            current[j] = std::min({ previous[j] + 1, current[j - 1] + 1, substitution });
+        }
+        std::swap(previous, current);
+    }
+    return previous[b.size()];
+}
+
+double median(QVector<double> values)
+{
+    if (values.isEmpty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+// High-water mark of the process's resident set, in KiB
+qint64 peakRssKb()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return qint64(counters.PeakWorkingSetSize / 1024);
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#if defined(Q_OS_DARWIN)
+    return qint64(usage.ru_maxrss / 1024); // Bytes on macOS
+#else
+    return qint64(usage.ru_maxrss);        // KiB on Linux and the BSDs
+#endif
+#endif
+}
+
+void printPeakRss(const char *phase)
+{
+    std::printf("peak RSS after %s: %.1f MiB\n", phase, peakRssKb() / 1024.0);
+    std::fflush(stdout);
+}
+
+// Runs every image iterations times through one scanner and prints latency and CER
+bool runAccuracy(const QString& mode, const QVector<ManifestEntry>& entries, int iterations,
+                 const OcrPreprocessOptions& options, bool verbose)
+{
+    const bool lineMode = mode == "lines";
+    OcrScanner scanner;
+    scanner.setPreprocessOptions(options);
+
+    auto scan = [&scanner, lineMode](const QString& path) {
+        return lineMode ? OcrScanner::joinLines(scanner.scanLines(path)) : scanner.scanImage(path);
+    };
+
+    // The first call waits for the language model to load; time it separately
+    QElapsedTimer timer;
+    timer.start();
+    scanner.warmUp();
+    scan(entries.first().path);
+    std::printf("\n[%s] engine start-up + first page: %.1f ms\n", qPrintable(mode), timer.nsecsElapsed() / 1e6);
+    if (!scanner.isReady()) {
+        std::fprintf(stderr, "Tesseract could not be initialised; check the tessdata path\n");
+        return false;
+    }
+
+    std::printf("%-22s %9s %9s %7s %7s %8s\n", "image", "p50 ms", "min ms", "chars", "edits", "CER %");
+
+    qsizetype totalChars = 0;
+    qsizetype totalEdits = 0;
+    int failures = 0;
+    double totalMedianMs = 0.0;
+
+    for (const ManifestEntry& entry : entries) {
+        ImageResult result;
+        QString text;
+        for (int i = 0; i < iterations; ++i) {
+            timer.restart();
+            text = scan(entry.path);
+            result.latenciesMs.append(timer.nsecsElapsed() / 1e6);
+        }
+        // "No text detected" is a legitimate answer for a page without text, not a failure
+        result.failed = isOcrError(text) && !text.contains("No text detected");
+        if (isOcrError(text)) {
+            text.clear();
+        }
+
+        QString recognised = normalizeForScoring(text);
+        if (entry.hasExpected) {
+            QString reference = normalizeForScoring(entry.expected);
+            result.referenceChars = reference.size();
+            result.edits = editDistance(recognised, reference);
+            totalChars += result.referenceChars;
+            totalEdits += result.edits;
+        }
+        if (result.failed) {
+            ++failures;
+        }
+
+        const double p50 = median(result.latenciesMs);
+        totalMedianMs += p50;
+        const double minMs = *std::min_element(result.latenciesMs.cbegin(), result.latenciesMs.cend());
+        if (entry.hasExpected) {
+            double cer = result.referenceChars > 0 ? 100.0 * result.edits / result.referenceChars : 0.0;
+            std::printf("%-22s %9.1f %9.1f %7lld %7lld %8.1f%s\n", qPrintable(entry.name), p50, minMs,
+                        static_cast<long long>(result.referenceChars), static_cast<long long>(result.edits),
+                        cer, result.failed ? "  (failed)" : "");
+        } else {
+            // No reference: show how much text was invented instead
+            std::printf("%-22s %9.1f %9.1f %7s %7lld %8s%s\n", qPrintable(entry.name), p50, minMs, "-",
+                        static_cast<long long>(recognised.size()), "-", result.failed ? "  (failed)" : "");
+        }
+        if (verbose) {
+            std::printf("    got: %s\n", qPrintable(text.simplified()));
+        }
+        std::fflush(stdout);
+    }
+
+    double overallCer = totalChars > 0 ? 100.0 * totalEdits / totalChars : 0.0;
+    std::printf("%-22s %9.1f %9s %7lld %7lld %8.1f\n", "total", totalMedianMs, "",
+                static_cast<long long>(totalChars), static_cast<long long>(totalEdits), overallCer);
+    if (failures > 0) {
+        std::printf("  %d image(s) could not be recognised\n", failures);
+    }
+    return true;
+}
+
+// Pushes passes copies of the manifest through an OcrEnginePool at 1..maxThreads engines
+void runThroughput(const QVector<ManifestEntry>& entries, int maxThreads, int passes,
+                   const OcrPreprocessOptions& options)
+{
+    QStringList pages;
+    for (int pass = 0; pass < passes; ++pass) {
+        for (const ManifestEntry& entry : entries) {
+            pages.append(entry.path);
+        }
+    }
+
+    std::printf("\n%-10s %9s %7s %10s %10s %9s %10s\n",
+                "engines", "init ms", "pages", "wall ms", "pages/s", "speedup", "peak MiB");
+
+    double singleEngineRate = 0.0;
+    for (int threads = 1; threads <= maxThreads; ++threads) {
+        QElapsedTimer timer;
+        timer.start();
+        OcrEnginePool pool(threads);
+        pool.setPreprocessOptions(options);
+        const double initMs = timer.nsecsElapsed() / 1e6;
+
+        timer.restart();
+        QFuture<QString> future = pool.scanImages(pages);
+        future.waitForFinished();
+        const double wallMs = timer.nsecsElapsed() / 1e6;
+
+        const double rate = wallMs > 0.0 ? pages.size() * 1000.0 / wallMs : 0.0;
+        if (threads == 1) {
+            singleEngineRate = rate;
+        }
+        std::printf("%-10d %9.1f %7lld %10.1f %10.2f %8.2fx %10.1f\n", threads, initMs,
+                    static_cast<long long>(pages.size()), wallMs, rate,
+                    singleEngineRate > 0.0 ? rate / singleEngineRate : 0.0, peakRssKb() / 1024.0);
+        std::fflush(stdout);
+    }
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    // Same identity as pipino_bench, so the remembered tessdata path is shared between the tools
+    app.setOrganizationName("DRBC-Systems");
+    app.setApplicationName("PipinoBench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("OCR latency, throughput and accuracy benchmark");
+    parser.addHelpOption();
+    QCommandLineOption manifestOption("manifest", "Images and expected text.", "path", "Assets/ocr_manifest.json");
+    QCommandLineOption iterationsOption("iterations", "Measured scans per image.", "n", "3");
+    QCommandLineOption maxThreadsOption("max-threads", "Largest engine pool for the throughput run.", "n",
+                                        QString::number(qMax(1, QThread::idealThreadCount())));
+    QCommandLineOption passesOption("passes", "Copies of the manifest per throughput run.", "n", "4");
+    QCommandLineOption modeOption("mode", "Recognition mode: page, lines or both.", "mode", "page");
+    QCommandLineOption noPreprocessOption("no-preprocess", "Hand the raw images to Tesseract.");
+    QCommandLineOption dpiOption("target-dpi", "Resolution the preprocessor scales to.", "dpi", "300");
+    QCommandLineOption skipThroughputOption("skip-throughput", "Only measure latency and accuracy.");
+    QCommandLineOption verboseOption("verbose", "Print the recognised text of every image.");
+    parser.addOptions({ manifestOption, iterationsOption, maxThreadsOption, passesOption, modeOption,
+                        noPreprocessOption, dpiOption, skipThroughputOption, verboseOption });
+    parser.process(app);
+
+    QVector<ManifestEntry> entries;
+    if (!loadManifest(parser.value(manifestOption), entries)) {
+        return 1;
+    }
+
+    OcrPreprocessOptions options;
+    options.enabled = !parser.isSet(noPreprocessOption);
+    options.targetDpi = qMax(72, parser.value(dpiOption).toInt());
+
+    const QString mode = parser.value(modeOption);
+    if (mode != "page" && mode != "lines" && mode != "both") {
+        std::fprintf(stderr, "Unknown mode %s; expected page, lines or both\n", qPrintable(mode));
+        return 1;
+    }
+
+    std::printf("OCR benchmark: %lld images, preprocessing %s (target %d dpi), tessdata %s\n",
+                static_cast<long long>(entries.size()), options.enabled ? "on" : "off", options.targetDpi,
+                qPrintable(OcrScanner::tessdataPath().isEmpty() ? QString("<default>") : OcrScanner::tessdataPath()));
+
+    const int iterations = qMax(1, parser.value(iterationsOption).toInt());
+    const bool verbose = parser.isSet(verboseOption);
+    for (const QString& pass : { QString("page"), QString("lines") }) {
+        if (mode != "both" && mode != pass) {
+            continue;
+        }
+        if (!runAccuracy(pass, entries, iterations, options, verbose)) {
+            return 1;
+        }
+        printPeakRss(pass == "page" ? "page mode" : "line mode");
+    }
+
+    if (!parser.isSet(skipThroughputOption)) {
+        runThroughput(entries, qMax(1, parser.value(maxThreadsOption).toInt()),
+                      qMax(1, parser.value(passesOption).toInt()), options);
+    }
+
+    return 0;
+}
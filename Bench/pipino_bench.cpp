@@ -0,0 +1,373 @@
+// End-to-end latency benchmark for the AI path.
+//
+// Starts MockGenAIServer (or uses --url), points every AIService at it and drives
+// AIService, ProblemGenerator and SolutionGrader with a fixed number of requests at
+// a fixed concurrency. Reports p50/p95/p99 latency and throughput per scenario, plus
+// a microbenchmark of ResponseParser that needs no server.
+//
+//   pipino_bench --requests 200 --concurrency 8 --latency 150 --jitter 50 --failure-rate 0.02
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFileInfo>
+#include <QHash>
+#include <QTimer>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include "AIResilience.h"
+#include "AIService.h"
+#include "AIResponseCache.h"
+#include "AITransport.h"
+#include "MockGenAIServer.h"
+#include "ProblemGenerator.h"
+#include "ResponseParser.h"
+#include "SolutionGrader.h"
+
+namespace {
+
+struct ScenarioResult {
+    QString name;
+    QVector<double> latenciesMs;
+    int errors = 0;
+    double wallMs = 0.0;
+};
+
+// Called once per request with whether it succeeded; later calls are ignored
+using Done = std::function<void(bool ok)>;
+// Starts request number index and eventually calls done
+using Starter = std::function<void(int index, Done done)>;
+
+double percentile(const QVector<double>& sorted, double p)
+{
+    if (sorted.isEmpty()) return 0.0;
+    // Nearest-rank
+    int rank = qBound(1, int(std::ceil(p / 100.0 * sorted.size())), int(sorted.size()));
+    return sorted[rank - 1];
+}
+
+void printHeader()
+{
+    std::printf("%-22s %7s %6s %9s %9s %9s %9s %10s\n",
+                "scenario", "n", "errors", "p50 ms", "p95 ms", "p99 ms", "max ms", "req/s");
+}
+
+void printResult(const ScenarioResult& result)
+{
+    QVector<double> sorted = result.latenciesMs;
+    std::sort(sorted.begin(), sorted.end());
+    double throughput = result.wallMs > 0.0 ? sorted.size() * 1000.0 / result.wallMs : 0.0;
+    std::printf("%-22s %7lld %6d %9.1f %9.1f %9.1f %9.1f %10.1f\n",
+                qPrintable(result.name), static_cast<long long>(sorted.size()), result.errors,
+                percentile(sorted, 50), percentile(sorted, 95), percentile(sorted, 99),
+                sorted.isEmpty() ? 0.0 : sorted.last(), throughput);
+    std::fflush(stdout);
+}
+
+// Keeps up to concurrency requests outstanding until total have completed
+ScenarioResult runScenario(const QString& name, int total, int concurrency, int warmup, const Starter& start)
+{
+    ScenarioResult result;
+    result.name = name;
+
+    // Warm-up requests open connections and fill lazy state; they are not measured
+    for (int i = 0; i < warmup; ++i) {
+        QEventLoop loop;
+        bool finished = false;
+        start(-1 - i, [&loop, &finished](bool) {
+            finished = true;
+            loop.quit();
+        });
+        if (!finished) {
+            loop.exec();
+        }
+    }
+
+    QEventLoop loop;
+    QElapsedTimer wall;
+    int started = 0;
+    int completed = 0;
+
+    std::function<void()> launch = [&]() {
+        const int index = started++;
+        auto timer = std::make_shared<QElapsedTimer>();
+        auto finished = std::make_shared<bool>(false);
+        timer->start();
+        start(index, [&, timer, finished](bool ok) {
+            if (*finished) return;
+            *finished = true;
+            result.latenciesMs.append(timer->nsecsElapsed() / 1e6);
+            if (!ok) ++result.errors;
+            if (++completed == total) {
+                loop.quit();
+            } else if (started < total) {
+                // Start the next one from the event loop, not from inside this callback
+                QTimer::singleShot(0, &loop, launch);
+            }
+        });
+    };
+
+    wall.start();
+    for (int i = 0; i < qMin(concurrency, total); ++i) {
+        launch();
+    }
+    if (completed < total) {
+        loop.exec();
+    }
+    result.wallMs = wall.nsecsElapsed() / 1e6;
+    return result;
+}
+
+void runParserBenchmark(int iterations)
+{
+    QString structured = R"({"schema": "pipino.problems/1", "problems": [)";
+    QString legacy;
+    for (int i = 0; i < 5; ++i) {
+        structured += QString(R"(%1{"statement": "Solve for x: %2x + 7 = %3", "choices": ["x = 2", "x = 4", "x = 6", "x = 8"], "correct": "B"})")
+                          .arg(i == 0 ? "" : ", ").arg(i + 2).arg((i + 2) * 4 + 7);
+        legacy += QString("PROBLEM %1: Solve for x: %2x + 7 = %3\nA) x = 2\nB) x = 4\nC) x = 6\nD) x = 8\nCORRECT: B\n\n")
+                      .arg(i + 1).arg(i + 2).arg((i + 2) * 4 + 7);
+    }
+    structured += "]}";
+
+    std::printf("\n%-22s %10s %12s %10s\n", "parser", "iterations", "ns/op", "MB/s");
+    for (const auto& input : { qMakePair(QString("parse structured"), structured),
+                               qMakePair(QString("parse legacy text"), legacy) }) {
+        int problems = 0;
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < iterations; ++i) {
+            problems += ResponseParser::parseProblems(input.second).size();
+        }
+        double ns = double(timer.nsecsElapsed());
+        double bytes = double(input.second.size()) * sizeof(QChar) * iterations;
+        std::printf("%-22s %10d %12.0f %10.1f\n", qPrintable(input.first), iterations,
+                    ns / iterations, bytes / (ns / 1e9) / 1e6);
+        if (problems != 5 * iterations) {
+            std::printf("  warning: parsed %d problems, expected %d\n", problems, 5 * iterations);
+        }
+    }
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    // Own application name, so the response cache and settings of the real app are untouched
+    app.setOrganizationName("DRBC-Systems");
+    app.setApplicationName("PipinoBench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("End-to-end latency benchmark for the AI request path");
+    parser.addHelpOption();
+    QCommandLineOption requestsOption("requests", "Measured requests per scenario.", "n", "100");
+    QCommandLineOption concurrencyOption("concurrency", "Requests kept in flight.", "n", "4");
+    QCommandLineOption warmupOption("warmup", "Unmeasured requests before each scenario.", "n", "3");
+    QCommandLineOption latencyOption("latency", "Mock server latency in ms.", "ms", "150");
+    QCommandLineOption jitterOption("jitter", "Mock server latency jitter in ms.", "ms", "50");
+    QCommandLineOption failureOption("failure-rate", "Share of mock requests that fail (0..1).", "rate", "0");
+    QCommandLineOption seedOption("seed", "Mock server random seed.", "n", "1");
+    QCommandLineOption maxInFlightOption("max-in-flight", "AITransport requests per endpoint.", "n", "4");
+    QCommandLineOption urlOption("url", "Benchmark an existing backend instead of the mock server.", "url");
+    QCommandLineOption imageOption("image", "Image uploaded by the ocr scenario.", "path", "Assets/test.png");
+    QCommandLineOption scenarioOption("scenario", "Run only these scenarios (repeatable).", "name");
+    QCommandLineOption parserIterationsOption("parser-iterations", "ResponseParser iterations.", "n", "20000");
+    parser.addOptions({ requestsOption, concurrencyOption, warmupOption, latencyOption, jitterOption,
+                        failureOption, seedOption, maxInFlightOption, urlOption, imageOption,
+                        scenarioOption, parserIterationsOption });
+    parser.process(app);
+
+    const int requests = qMax(1, parser.value(requestsOption).toInt());
+    const int concurrency = qMax(1, parser.value(concurrencyOption).toInt());
+    const int warmup = qMax(0, parser.value(warmupOption).toInt());
+    const QStringList only = parser.values(scenarioOption);
+    auto enabled = [&only](const QString& name) { return only.isEmpty() || only.contains(name); };
+
+    MockGenAIServer::Config config;
+    config.latencyMs = parser.value(latencyOption).toInt();
+    config.jitterMs = parser.value(jitterOption).toInt();
+    config.failureRate = parser.value(failureOption).toDouble();
+    config.seed = parser.value(seedOption).toUInt();
+    MockGenAIServer server(config);
+
+    if (parser.isSet(urlOption)) {
+        AIService::setDefaultBaseUrl(parser.value(urlOption));
+    } else {
+        if (!server.listen()) {
+            std::fprintf(stderr, "Could not start the mock server\n");
+            return 1;
+        }
+        AIService::setDefaultBaseUrl(server.baseUrl());
+    }
+    AITransport::instance().setMaxInFlightPerEndpoint(parser.value(maxInFlightOption).toInt());
+
+    // Every request carries a unique message, so neither the cache nor coalescing hides latency
+    AIResponseCache::instance().clear();
+
+    std::printf("backend: %s  requests: %d  concurrency: %d\n",
+                qPrintable(AIService::defaultBaseUrl()), requests, concurrency);
+    if (!parser.isSet(urlOption)) {
+        std::printf("mock: latency %d ms +/- %d ms, failure rate %.3f\n",
+                    config.latencyMs, config.jitterMs, config.failureRate);
+    }
+    std::printf("\n");
+    printHeader();
+
+    AIService service;
+    ProblemGenerator generator;
+    SolutionGrader grader;
+
+    if (enabled("prompt")) {
+        printResult(runScenario("prompt", requests, concurrency, warmup, [&](int i, Done done) {
+            service.promptAsync(QString("Benchmark prompt %1").arg(i),
+                                [done](const AiResult<QString>& response) { done(response.ok()); });
+        }));
+    }
+
+    if (enabled("stream")) {
+        // Time to first chunk and to the end of the stream, from the same requests
+        ScenarioResult firstChunk;
+        firstChunk.name = "stream first chunk";
+        QHash<quint64, std::shared_ptr<QElapsedTimer>> streamTimers;
+        QHash<quint64, Done> streamDone;
+        QObject context;
+        QObject::connect(&service, &AIService::chunkReceived, &context, [&](quint64 id, const QString&) {
+            auto it = streamTimers.find(id);
+            if (it != streamTimers.end()) {
+                firstChunk.latenciesMs.append(it.value()->nsecsElapsed() / 1e6);
+                streamTimers.erase(it);
+            }
+        });
+        QObject::connect(&service, &AIService::streamFinished, &context, [&](quint64 id, const AiResult<QString>& response) {
+            streamTimers.remove(id);
+            Done done = streamDone.take(id);
+            if (done) done(response.ok());
+        });
+
+        ScenarioResult whole = runScenario("stream complete", requests, concurrency, warmup, [&](int i, Done done) {
+            auto timer = std::make_shared<QElapsedTimer>();
+            timer->start();
+            quint64 id = service.stream(QString("Benchmark stream %1").arg(i));
+            if (i >= 0) {
+                streamTimers.insert(id, timer);
+            }
+            streamDone.insert(id, done);
+        });
+        firstChunk.wallMs = whole.wallMs;
+        printResult(firstChunk);
+        printResult(whole);
+    }
+
+    // chat(), ocr() and gradeSolutionAsync() report through signals without a request id,
+    // so those scenarios keep one request in flight and hand the result to whoever is waiting
+    Done waiting;
+    auto finishWaiting = [&waiting](bool ok) {
+        Done done = std::move(waiting);
+        waiting = nullptr;
+        if (done) done(ok);
+    };
+    QObject signalContext;
+    QObject::connect(&service, &AIService::finished, &signalContext, [&](const QString& response) {
+        finishWaiting(!response.isEmpty());
+    });
+    QObject::connect(&service, &AIService::errorOccurred, &signalContext, [&](const QString&) {
+        finishWaiting(false);
+    });
+    QObject::connect(&grader, &SolutionGrader::gradingComplete, &signalContext, [&](const QString& feedback) {
+        finishWaiting(!feedback.isEmpty());
+    });
+    QObject::connect(&grader, &SolutionGrader::gradingError, &signalContext, [&](const QString&) {
+        finishWaiting(false);
+    });
+
+    if (enabled("chat")) {
+        printResult(runScenario("chat", requests, 1, warmup, [&](int i, Done done) {
+            waiting = done;
+            // Same MessageDto shape as the backend expects; the first message must come from the human
+            service.chat(QJsonArray{ QJsonObject{{"type", "Human"}, {"text", QString("Benchmark chat %1").arg(i)}} });
+        }));
+    }
+
+    if (enabled("ocr")) {
+        QString image = parser.value(imageOption);
+        if (!QFileInfo::exists(image)) {
+            std::printf("%-22s skipped: %s not found (use --image)\n", "ocr", qPrintable(image));
+        } else {
+            printResult(runScenario("ocr", requests, 1, warmup, [&](int, Done done) {
+                waiting = done;
+                service.ocr(image);
+            }));
+        }
+    }
+
+    if (enabled("generate")) {
+        printResult(runScenario("generate problem", requests, concurrency, warmup, [&](int i, Done done) {
+            generator.generateCompleteProblemAsync(QString("Linear Equations %1").arg(i), Difficulty::Medium, true,
+                [done](const AiResult<GeneratedProblem>& problem) {
+                    done(problem.ok() && problem.value().choices.size() == 4);
+                });
+        }));
+    }
+
+    if (enabled("batch")) {
+        printResult(runScenario("generate batch x5", requests, concurrency, warmup, [&](int i, Done done) {
+            generator.generateBatchAsync(QString("Fractions %1").arg(i), Difficulty::Easy, 5, true,
+                [done](const AiResult<QVector<GeneratedProblem>>& problems) {
+                    done(problems.ok() && problems.value().size() == 5);
+                });
+        }));
+    }
+
+    if (enabled("grade")) {
+        printResult(runScenario("grade", requests, 1, warmup, [&](int i, Done done) {
+            waiting = done;
+            grader.gradeSolutionAsync("2x + 5 = 13\n2x = 8\nx = 4", QString("Solve for x: 2x + 5 = 13 (#%1)").arg(i));
+        }));
+    }
+
+    if (enabled("feedback")) {
+        QHash<quint64, Done> feedbackDone;
+        QObject context;
+        QObject::connect(&grader, &SolutionGrader::feedbackStreamFinished, &context, [&](quint64 id, const AiResult<QString>& feedback) {
+            Done done = feedbackDone.take(id);
+            if (done) done(feedback.ok());
+        });
+        printResult(runScenario("feedback stream", requests, concurrency, warmup, [&](int i, Done done) {
+            quint64 id = grader.streamDetailedFeedback("2x + 5 = 13\n2x = 18\nx = 9",
+                                                       QString("Solve for x: 2x + 5 = 13 (#%1)").arg(i));
+            feedbackDone.insert(id, done);
+        }));
+    }
+
+    AITransport::Stats transport = AITransport::instance().stats();
+    std::printf("\ntransport: %llu dispatched, %llu coalesced, %llu over HTTP/2, max queue wait %lld ms\n",
+                static_cast<unsigned long long>(transport.dispatched),
+                static_cast<unsigned long long>(transport.coalesced),
+                static_cast<unsigned long long>(transport.http2Replies),
+                static_cast<long long>(transport.maxQueueWaitMs));
+    AIResilience::Stats resilience = AIResilience::instance().stats();
+    std::printf("resilience: %llu retries, %llu hedges (%llu won), %llu short-circuited, %llu breaker opens\n",
+                static_cast<unsigned long long>(resilience.retries),
+                static_cast<unsigned long long>(resilience.hedges),
+                static_cast<unsigned long long>(resilience.hedgeWins),
+                static_cast<unsigned long long>(resilience.shortCircuited),
+                static_cast<unsigned long long>(resilience.breakerOpens));
+    if (!parser.isSet(urlOption)) {
+        MockGenAIServer::Stats mock = server.stats();
+        std::printf("mock server: %llu requests, %llu injected failures, %llu rejected\n",
+                    static_cast<unsigned long long>(mock.requests),
+                    static_cast<unsigned long long>(mock.injectedFailures),
+                    static_cast<unsigned long long>(mock.rejected));
+    }
+
+    if (enabled("parser")) {
+        runParserBenchmark(qMax(1, parser.value(parserIterationsOption).toInt()));
+    }
+
+    return 0;
+}
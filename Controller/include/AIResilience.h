@@ -0,0 +1,119 @@
+#ifndef AIRESILIENCE_H
+#define AIRESILIENCE_H
+
+#include <QString>
+#include <QHash>
+#include <QVector>
+#include <QElapsedTimer>
+#include "AiResult.h"
+#include "AITransport.h"
+
+/**
+ * @brief Retry and hedging rules for one request
+ *
+ * Retries wait baseDelayMs * 2^(n-1), capped at maxDelayMs, with equal jitter so
+ * clients that failed together do not retry in lock-step. Only idempotent requests
+ * may retry or hedge; a multipart upload, for instance, cannot be replayed.
+ */
+struct AIRetryPolicy {
+    int maxAttempts = 3;
+    int baseDelayMs = 250;
+    int maxDelayMs = 4000;
+    bool hedge = false;       // Send a duplicate once the first attempt is slower than the endpoint's p95
+
+    static AIRetryPolicy none();
+    static AIRetryPolicy interactive();
+    static AIRetryPolicy background();
+};
+
+/**
+ * @brief Process-wide failure and latency bookkeeping shared by every AIService
+ *
+ * Keeps one circuit breaker per backend. After failureThreshold consecutive backend
+ * failures the breaker opens and requests fail at once (callers then fall back to the
+ * response cache) instead of each waiting for its own timeout. Once the open interval
+ * has passed one probe request is let through; success closes the breaker, failure
+ * reopens it for twice as long, up to a limit.
+ *
+ * Also tracks the recent latencies of each endpoint, separately per request priority
+ * (a background batch of five problems says nothing about how long a grade takes),
+ * from which the hedging delay (the p95) is derived. The endpoint is always the
+ * request's URL path.
+ *
+ * Must be used from the GUI thread only, like AITransport.
+ */
+class AIResilience
+{
+public:
+    enum class BreakerState { Closed, Open, HalfOpen };
+
+    struct Stats {
+        quint64 retries = 0;
+        quint64 hedges = 0;          // Duplicate requests sent
+        quint64 hedgeWins = 0;       // Duplicates that answered first
+        quint64 shortCircuited = 0;  // Requests refused while a breaker was open
+        quint64 breakerOpens = 0;
+    };
+
+    static AIResilience& instance();
+
+    AIResilience(const AIResilience&) = delete;
+    AIResilience& operator=(const AIResilience&) = delete;
+
+    /**
+     * @brief Whether a request to backend may be sent now; false while its breaker is open
+     */
+    bool allowRequest(const QString &backend);
+    void recordSuccess(const QString &backend, const QString &endpoint, AIPriority priority, qint64 latencyMs);
+    void recordFailure(const QString &backend, const AIStatus &status);
+    BreakerState breakerState(const QString &backend) const;
+
+    /**
+     * @brief Delay before retry number retry (1-based), with jitter
+     */
+    int retryDelayMs(const AIRetryPolicy &policy, int retry) const;
+
+    /**
+     * @brief How long to wait for an endpoint before hedging: its recent p95, clamped
+     *
+     * -1 (do not hedge) until enough latencies have been recorded for the endpoint.
+     */
+    int hedgeDelayMs(const QString &endpoint, AIPriority priority) const;
+
+    void countRetry() { ++counters.retries; }
+    void countHedge() { ++counters.hedges; }
+    void countHedgeWin() { ++counters.hedgeWins; }
+
+    void setFailureThreshold(int failures);
+    void setOpenInterval(int baseMs, int maxMs);
+
+    Stats stats() const { return counters; }
+
+private:
+    struct Breaker {
+        BreakerState state = BreakerState::Closed;
+        int consecutiveFailures = 0;
+        int openIntervalMs = 0;
+        QElapsedTimer openedFor;    // Since the breaker opened or the last probe was let through
+    };
+
+    // Fixed-size ring of recent successful latencies
+    struct LatencyWindow {
+        QVector<int> samples;
+        int next = 0;
+    };
+
+    AIResilience();
+
+    QHash<QString, Breaker> breakers;
+    QHash<QString, LatencyWindow> latencies;   // By latencyKey()
+    int failureThreshold;
+    int baseOpenIntervalMs;
+    int maxOpenIntervalMs;
+    Stats counters;
+
+    void open(Breaker &breaker, const QString &backend);
+    static QString latencyKey(const QString &endpoint, AIPriority priority);
+};
+
+#endif // AIRESILIENCE_H
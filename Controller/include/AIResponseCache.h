@@ -0,0 +1,99 @@
+#ifndef AIRESPONSECACHE_H
+#define AIRESPONSECACHE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QFile>
+#include <QMutex>
+
+/**
+ * @brief Persistent, content-addressed cache for AI backend responses
+ *
+ * Entries are keyed by a hash of endpoint + payload and stored in an append-only
+ * file under the application data directory. An in-memory index maps each key to
+ * the offset of its latest record, so lookups cost one seek + read. Entries expire
+ * after a TTL but stay in the index, across restarts too, as stale entries for the
+ * offline fallback (lookup with allowExpired). Once the live data exceeds the size cap,
+ * stale entries are evicted first, then the least recently used ones. The file is
+ * compacted when most of it is dead records.
+ *
+ * One instance is shared by every AIService in the process (see instance()).
+ */
+class AIResponseCache
+{
+public:
+    struct Stats {
+        quint64 hits = 0;
+        quint64 misses = 0;
+        quint64 evictions = 0;
+        int entries = 0;
+        qint64 liveBytes = 0;   // Payload bytes reachable through the index
+        qint64 fileBytes = 0;   // Size of the append-only file including dead records
+    };
+
+    static AIResponseCache& instance();
+
+    /**
+     * @brief Open (or create) a cache backed by filePath and index its records
+     */
+    explicit AIResponseCache(const QString& filePath);
+    ~AIResponseCache();
+
+    AIResponseCache(const AIResponseCache&) = delete;
+    AIResponseCache& operator=(const AIResponseCache&) = delete;
+
+    /**
+     * @brief Build the cache key for a request
+     * @param endpoint The endpoint path, e.g. "/prompt"
+     * @param payload The query message or request body
+     */
+    static QByteArray makeKey(const QString& endpoint, const QByteArray& payload);
+
+    /**
+     * @brief Look up a response
+     * @param allowExpired Also return entries past their TTL (offline fallback)
+     * @return true and fills response on a hit
+     */
+    bool lookup(const QByteArray& key, QString& response, bool allowExpired = false);
+
+    void store(const QByteArray& key, const QString& response);
+    void clear();
+
+    void setTimeToLive(qint64 seconds);
+    void setMaxBytes(qint64 bytes);
+
+    Stats stats() const;
+
+private:
+    struct Entry {
+        qint64 valueOffset = 0;  // File offset of the UTF-8 payload
+        qint32 valueSize = 0;
+        qint64 storedAtMs = 0;   // Wall clock time the response was stored
+        quint64 lastUsed = 0;    // Logical clock for LRU ordering
+    };
+
+    QString filePath;
+    QFile file;
+    QHash<QByteArray, Entry> index;
+    mutable QMutex mutex;
+
+    qint64 ttlMs;
+    qint64 maxBytes;
+    qint64 liveBytes;
+    quint64 useClock;
+
+    quint64 hitCount;
+    quint64 missCount;
+    quint64 evictionCount;
+
+    void loadIndex();
+    bool appendRecord(const QByteArray& key, const QByteArray& value, qint64 storedAtMs, Entry& entry);
+    bool readValue(const Entry& entry, QByteArray& value);
+    void removeEntry(const QByteArray& key);
+    void evictIfNeeded();
+    void compactIfNeeded();
+    bool isExpired(const Entry& entry, qint64 nowMs) const;
+};
+
+#endif // AIRESPONSECACHE_H
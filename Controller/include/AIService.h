@@ -10,6 +10,12 @@
 #include <QFileInfo>
 #include <QHttpMultiPart>
 #include <QFile>
+#include <QHash>
+#include <QElapsedTimer>
+#include <functional>
+#include "AIResilience.h"
+#include "AiResult.h"
+#include "AITransport.h"
 
 class AIService : public QObject
 {
@@ -24,22 +30,100 @@ public:
     void rag(const QString &query);
 
     // OCR endpoints
-    void ocr(const QString &imagePath);                          // async
-    QString ocrSync(const QString &imagePath, int timeoutMs = 10000); // blocking
+    void ocr(const QString &imagePath);                                      // async
+    AiResult<QString> ocrSync(const QString &imagePath, int timeoutMs = 10000); // blocking
 
-    // Synchronous method that blocks and returns response
-    QString promptSync(const QString &message, int timeoutMs = 10000);
+    // Synchronous method that blocks and returns the response. timeoutMs bounds the whole
+    // call, retries included.
+    AiResult<QString> promptSync(const QString &message, int timeoutMs = 10000);
+
+    // Non-blocking prompt bound to a single request. The handler is invoked on the
+    // GUI thread with the result unless the request is cancelled.
+    // Failed attempts are retried with backoff within timeoutMs (see AIRetryPolicy);
+    // Interactive requests are also hedged when the backend is slower than usual.
+    using ResponseHandler = std::function<void(const AiResult<QString> &result)>;
+    quint64 promptAsync(const QString &message, ResponseHandler handler, int timeoutMs = 10000,
+                        AIPriority priority = AIPriority::Normal);
+    void cancel(quint64 requestId);
+
+    // Streams a prompt from /stream: chunkReceived is emitted as each piece of text arrives,
+    // then streamFinished with the whole answer or the error. Cancel with cancel().
+    // A half-delivered stream cannot be replayed, so streams are never retried.
+    quint64 stream(const QString &message, int timeoutMs = 10000);
+
+    // Scheduling class for every other call made through this service (see AITransport)
+    void setPriority(AIPriority priority);
+    AIPriority priority() const;
+
+    // Persistent response cache (see AIResponseCache). With bypass on, lookups are skipped so
+    // every call reaches the backend, but responses are still stored for offline fallback.
+    // Without bypass, identical requests already in flight anywhere in the process share one
+    // upstream call (see AITransport::Stats::coalesced).
+    void setCacheBypass(bool bypass);
+    bool cacheBypass() const;
+
+    // Backend every new AIService talks to: setDefaultBaseUrl() if called, otherwise the
+    // "ai/baseUrl" setting, otherwise the local bootstrap API. Lets tools such as
+    // pipino_bench point the whole stack at a stand-in server.
+    static void setDefaultBaseUrl(const QString &url);
+    static QString defaultBaseUrl();
 
 signals:
+    // prompt(), chat(), embeddings(), rag() and ocr() report through these: finished on
+    // success (including a stale cached answer), errorOccurred otherwise, never both
     void finished(const QString &response);
     void errorOccurred(const QString &error);
-
-private slots:
-    void handleReply(QNetworkReply *reply);
+    void chunkReceived(quint64 requestId, const QString &chunk);
+    void streamFinished(quint64 requestId, const AiResult<QString> &result);
 
 private:
-    QNetworkAccessManager *manager;
-    const QString baseUrl = "http://localhost:3000/genai";
+    // Called once per call with the body (empty unless status.ok()) and the final status
+    using CallHandler = std::function<void(const QByteArray &body, const AIStatus &status)>;
+
+    // One logical request and every attempt (retry or hedge) made for it
+    struct Call {
+        QNetworkRequest request;
+        QByteArray postBody;
+        bool post = false;
+        AIPriority priority = AIPriority::Normal;
+        QByteArray coalesceKey;
+        AIRetryPolicy policy;
+        int timeoutMs = 10000;
+        QElapsedTimer elapsed;
+        QHash<quint64, qint64> attemptsInFlight; // Transport ticket -> start time within the call
+        quint64 hedgeTicket = 0;
+        int attempts = 0;
+        bool hedged = false;
+        AIStatus lastFailure;                    // Most recent failed attempt, reported once the call ends
+        CallHandler handler;
+    };
+
+    QHash<quint64, Call> calls;               // By request id, including cache hits not yet delivered
+    QHash<quint64, quint64> pendingRequests;  // stream request id -> transport ticket (0 for cache hits)
+    quint64 nextRequestId = 1;
+    bool bypassCache = false;
+    AIPriority requestPriority = AIPriority::Normal;
+
+    Call makeCall(const QNetworkRequest &request, AIPriority priority, int timeoutMs,
+                  const QByteArray &coalesce) const;
+    void startCall(quint64 callId, Call call, CallHandler handler);
+    void sendAttempt(quint64 callId, bool hedge);
+    void onAttemptFinished(quint64 callId, quint64 ticket, QNetworkReply *reply, const QByteArray &body);
+    void finishCall(quint64 callId, const QByteArray &body, AIStatus status);
+    void abortAttempts(const Call &call);
+    void recordOutcome(const QString &endpoint, AIPriority priority, const AIStatus &status, qint64 latencyMs);
+
+    void handleResult(const QByteArray &body, const AIStatus &status, const QByteArray &cacheKey);
+    QNetworkRequest messageRequest(const QString &endpoint, const QString &message) const;
+    QByteArray coalesceKey(const QByteArray &cacheKey) const;
+    AiResult<QString> waitForReply(const std::function<quint64(AITransport::ReplyHandler)> &send,
+                                   AIPriority priority, int timeoutMs, const QString &serviceName);
+    QHttpMultiPart *createImageUpload(const QString &imagePath);
+
+    bool lookupCache(const QByteArray &cacheKey, QString &response) const;
+    bool lookupFallback(const QByteArray &cacheKey, QString &response) const;
+    bool applyFallback(const QByteArray &cacheKey, QString &response, AIStatus &status) const;
+    const QString baseUrl;
 };
 
 #endif // AISERVICE_H
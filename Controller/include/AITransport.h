@@ -0,0 +1,169 @@
+#ifndef AITRANSPORT_H
+#define AITRANSPORT_H
+
+#include <QObject>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QHttpMultiPart>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <QUrl>
+#include <functional>
+
+/**
+ * @brief Scheduling class of a backend request
+ *
+ * Interactive requests (the user is waiting, e.g. grading) are dispatched before
+ * Normal ones, and Background work (e.g. ProblemPool prefetch) only gets a slot
+ * when nothing more urgent is queued for the same endpoint.
+ */
+enum class AIPriority {
+    Interactive,
+    Normal,
+    Background
+};
+
+/**
+ * @brief Process-wide HTTP transport shared by every AIService
+ *
+ * Owns the single QNetworkAccessManager of the application, so all services reuse
+ * the same keep-alive connections (and HTTP/2 sessions where the server offers them)
+ * instead of each opening their own. Requests are queued per endpoint path with at
+ * most maxInFlightPerEndpoint() on the wire at once, highest priority first and in
+ * submission order within a priority.
+ *
+ * Must be used from the GUI thread only.
+ */
+class AITransport : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Called once with the finished reply and its body; the transport deletes the reply afterwards
+     */
+    using ReplyHandler = std::function<void(QNetworkReply *reply, const QByteArray &body)>;
+
+    /**
+     * @brief Called each time streamed body data arrives; read it with reply->readAll()
+     */
+    using ReadyReadHandler = std::function<void(QNetworkReply *reply)>;
+
+    struct Stats {
+        quint64 dispatched = 0;
+        quint64 coalesced = 0;       // Upstream calls saved by joining an identical in-flight request
+        quint64 http2Replies = 0;    // Replies that were multiplexed over HTTP/2
+        qint64 totalQueueWaitMs = 0; // Time requests spent waiting for a free slot
+        qint64 maxQueueWaitMs = 0;
+        int queued = 0;
+        int inFlight = 0;
+    };
+
+    static AITransport& instance();
+
+    AITransport(const AITransport&) = delete;
+    AITransport& operator=(const AITransport&) = delete;
+
+    /**
+     * @brief Queue a request
+     * @param context Handler is skipped if this object is destroyed first (may be null)
+     * @param coalesceKey Requests with the same non-empty key that are queued or on the wire
+     *        share one upstream call, and every caller's handler gets the same reply. Leave
+     *        empty when each call must reach the backend (e.g. fresh problem generation).
+     * @return Ticket for abort(), never 0
+     */
+    quint64 get(const QNetworkRequest& request, AIPriority priority, QObject *context,
+                ReplyHandler handler, const QByteArray& coalesceKey = QByteArray());
+    quint64 post(const QNetworkRequest& request, const QByteArray& body, AIPriority priority,
+                 QObject *context, ReplyHandler handler, const QByteArray& coalesceKey = QByteArray());
+    /**
+     * @brief Queue a multipart upload; the transport takes ownership of multiPart
+     */
+    quint64 post(const QNetworkRequest& request, QHttpMultiPart *multiPart, AIPriority priority,
+                 QObject *context, ReplyHandler handler);
+    /**
+     * @brief Queue a streaming GET; readyReadHandler sees the body as it arrives and the
+     *        finished handler only gets what was left unread. Streams are never coalesced.
+     */
+    quint64 getStream(const QNetworkRequest& request, AIPriority priority, QObject *context,
+                      ReplyHandler handler, ReadyReadHandler readyReadHandler);
+
+    /**
+     * @brief Drop a caller's interest in a request; its handler is not called. The request
+     *        itself is dequeued or aborted once no coalesced caller is left waiting on it.
+     */
+    void abort(quint64 ticket);
+
+    /**
+     * @brief Open the connection to a backend ahead of the first request
+     */
+    void preconnect(const QUrl& url);
+
+    void setMaxInFlightPerEndpoint(int count);
+    int maxInFlightPerEndpoint() const;
+
+    Stats stats() const;
+
+private:
+    enum class Operation { Get, Post, PostMultiPart };
+
+    // One caller waiting on a request
+    struct Waiter {
+        quint64 ticket = 0;
+        QPointer<QObject> context;
+        bool hasContext = false;
+        ReplyHandler handler;
+    };
+
+    struct Pending {
+        quint64 requestId = 0;
+        AIPriority priority = AIPriority::Normal;
+        Operation operation = Operation::Get;
+        QNetworkRequest request;
+        QByteArray body;
+        QHttpMultiPart *multiPart = nullptr;
+        QByteArray coalesceKey;
+        QList<Waiter> waiters;
+        ReadyReadHandler readyReadHandler;
+        QElapsedTimer queuedFor;
+    };
+
+    struct Active {
+        QString endpoint;
+        QNetworkReply *reply = nullptr;
+        QByteArray coalesceKey;
+        QList<Waiter> waiters;
+        ReadyReadHandler readyReadHandler;
+    };
+
+    explicit AITransport(QObject *parent = nullptr);
+
+    QNetworkAccessManager *manager;
+    QHash<QString, QList<Pending>> queues; // Per endpoint, ordered by priority then arrival
+    QHash<QString, int> inFlightPerEndpoint;
+    QHash<quint64, Active> active;         // By request id
+    QHash<quint64, quint64> ticketRequests; // Caller ticket -> request id
+    QHash<QByteArray, quint64> coalescing; // Coalesce key -> request id, queued or on the wire
+    QSet<QString> preconnectedHosts;
+    quint64 nextTicket;
+    quint64 nextRequestId;
+    int maxInFlight;
+    bool allowHttp2Cleartext;
+    Stats counters;
+
+    quint64 enqueue(Pending pending, QObject *context, ReplyHandler handler);
+    bool joinInFlight(const QByteArray& coalesceKey, AIPriority priority, const Waiter& waiter);
+    Pending *findQueued(quint64 requestId, QString *endpoint = nullptr, int *position = nullptr);
+    void insertByPriority(QList<Pending>& queue, Pending pending);
+    void dispatch(const QString& endpoint);
+    void start(const QString& endpoint, Pending pending);
+    void onReplyReadyRead(quint64 requestId);
+    void onReplyFinished(quint64 requestId);
+    QNetworkRequest prepareRequest(QNetworkRequest request, AIPriority priority) const;
+};
+
+#endif // AITRANSPORT_H
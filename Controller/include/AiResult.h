@@ -0,0 +1,135 @@
+#ifndef AIRESULT_H
+#define AIRESULT_H
+
+#include <QString>
+#include <type_traits>
+#include <utility>
+
+class QNetworkReply;
+
+/**
+ * @brief Outcome class of a backend request
+ */
+enum class AIStatusCode {
+    Ok,
+    Timeout,          // No answer within the caller's time budget
+    NetworkError,     // Connection refused, reset, DNS failure, ...
+    ServerError,      // HTTP 5xx or 429: the backend is struggling, worth retrying
+    ClientError,      // HTTP 4xx: retrying the same request cannot help
+    CircuitOpen,      // Not sent: the backend failed repeatedly and is being given time to recover
+    Cancelled,
+    InvalidResponse,  // The backend answered, but not with anything usable
+    NotConfigured     // The caller has no AI service or model to work with
+};
+
+/**
+ * @brief Error code and per-request metadata of a backend call
+ */
+struct AIStatus {
+    AIStatusCode code = AIStatusCode::Ok;
+    QString message;          // Human-readable cause when not ok()
+    int httpStatus = 0;       // 0 when no HTTP response arrived
+    int attempts = 0;         // Requests put on the wire, including retries and hedges
+    bool hedged = false;      // A duplicate request was sent because the first was slow
+    bool fromCache = false;   // Served from AIResponseCache without reaching the backend
+    bool stale = false;       // The backend failed and an earlier cached answer was used instead
+    qint64 elapsedMs = 0;
+    qint64 bytes = 0;         // Response body size
+
+    bool ok() const { return code == AIStatusCode::Ok; }
+
+    /**
+     * @brief Worth sending again: transient network trouble or an overloaded backend
+     */
+    bool isRetryable() const;
+
+    /**
+     * @brief Counts towards opening the circuit breaker (client errors and cancellations do not)
+     */
+    bool isBackendFailure() const;
+
+    /**
+     * @brief Same metadata, but failed with code, e.g. a reply that did not parse
+     */
+    AIStatus withError(AIStatusCode code, const QString &message) const;
+
+    /**
+     * @brief "Error: ..." / "Timeout: ..." text for display and logs
+     */
+    QString toErrorString() const;
+
+    static AIStatus fromReply(QNetworkReply *reply);
+    static AIStatus failure(AIStatusCode code, const QString &message);
+};
+
+/**
+ * @brief A value from the AI backend, or why there is none
+ *
+ * Carried through AIService, ProblemGenerator, SolutionGrader and Controller in place
+ * of "Error:"-prefixed strings, so failure is a branch on ok() rather than a string scan
+ * and every layer can see the latency, size and cache origin of the request behind it.
+ *
+ * A default-constructed result is a failure (Cancelled) without a value.
+ */
+template <typename T>
+class AiResult
+{
+public:
+    AiResult() { meta.code = AIStatusCode::Cancelled; }
+
+    static AiResult success(T value, AIStatus status = AIStatus())
+    {
+        AiResult result;
+        result.payload = std::move(value);
+        result.meta = std::move(status);
+        result.meta.code = AIStatusCode::Ok;
+        return result;
+    }
+
+    static AiResult failure(AIStatus status)
+    {
+        AiResult result;
+        result.meta = std::move(status);
+        return result;
+    }
+
+    static AiResult failure(AIStatusCode code, const QString &message)
+    {
+        return failure(AIStatus::failure(code, message));
+    }
+
+    bool ok() const { return meta.ok(); }
+    explicit operator bool() const { return ok(); }
+
+    const T &value() const { return payload; }
+    T &value() { return payload; }
+    T valueOr(T fallback) const { return ok() ? payload : std::move(fallback); }
+
+    AIStatusCode error() const { return meta.code; }
+    const QString &errorMessage() const { return meta.message; }
+    QString errorString() const { return meta.toErrorString(); }
+
+    const AIStatus &status() const { return meta; }
+    qint64 latencyMs() const { return meta.elapsedMs; }
+    qint64 bytes() const { return meta.bytes; }
+    bool cacheHit() const { return meta.fromCache; }
+
+    /**
+     * @brief Transform the value, keeping the metadata; failures pass through untouched
+     */
+    template <typename F>
+    auto map(F &&f) const -> AiResult<std::decay_t<std::invoke_result_t<F, const T &>>>
+    {
+        using U = std::decay_t<std::invoke_result_t<F, const T &>>;
+        if (!ok()) {
+            return AiResult<U>::failure(meta);
+        }
+        return AiResult<U>::success(std::forward<F>(f)(payload), meta);
+    }
+
+private:
+    T payload{};
+    AIStatus meta;
+};
+
+#endif // AIRESULT_H
@@ -3,10 +3,12 @@
 
 #include <QObject>
 #include <QDebug>
+#include <QElapsedTimer>
+#include "ProblemPool.h"
+#include "EventLog.h"
 
 class Model;
 class View;
-class ProblemGenerator;
 
 class Controller : public QObject
 {
@@ -39,13 +41,30 @@ private:
     Model* model;
     View* view;
     ProblemGenerator* problemGenerator;
+    ProblemPool* problemPool;
     
     // Current context for navigation
     int currentUnitIndex;
     int currentProblemIndex;
+    ProblemId currentProblemId; // Where generated content goes, even if indices shift meanwhile
     
+    // The current selection missed the pool and waits for it to generate pendingPoolKey
+    bool waitingForPool;
+    ProblemPoolKey pendingPoolKey;
+    
+    // For the latencies in the event log
+    QElapsedTimer selectionTimer;     // Since the current problem was selected
+    QElapsedTimer problemShownTimer;  // Since its content was shown; invalid until then
+    
+    void onPoolProblemReady(const ProblemPoolKey& key);
+    void onPoolGenerationFailed(const ProblemPoolKey& key, const AIStatus& status);
+    void applyGeneratedProblem(ProblemId problemId, bool multipleChoice,
+                               const AiResult<GeneratedProblem>& result);
+    void recordProblemShown(ProblemId problemId);
     void connectSignals();
-    void logUserAction(const QString& action, const QString& details = "");
+    
+    // A user event tagged with the current unit, problem and difficulty
+    UserEvent contextEvent(UserEvent::Type type) const;
 };
 
 #endif // CONTROLLER_H
@@ -0,0 +1,127 @@
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include <QString>
+#include <QFile>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "Model.h"
+
+/**
+ * @brief One user interaction, kept as plain fields until the writer thread formats it
+ *
+ * Fields that do not apply to an event type keep their default (-1, 0 or empty) and
+ * are left out of the written record.
+ */
+struct UserEvent {
+    enum class Type : quint8 {
+        AppStarted,
+        ProblemSelected,   // latencyMs unused
+        ProblemShown,      // Generated content reached the dialog; latencyMs since selection
+        AnswerSelected,    // choice, correctChoice, correct; latencyMs since the problem was shown
+        ScanRequested,
+        TheoryOpened,
+        SettingsOpened,
+        BackNavigated,
+        UnitAdded,         // name
+        ProblemAdded       // name
+    };
+
+    explicit UserEvent(Type type = Type::AppStarted) : type(type) {}
+
+    Type type;
+    qint64 timestampMs = 0;     // Wall clock; filled in by EventLog::record()
+    ProblemId problemId = 0;
+    int unitIndex = -1;
+    int problemIndex = -1;
+    int difficulty = -1;        // A Difficulty value
+    int choice = -1;
+    int correctChoice = -1;
+    qint8 correct = -1;         // 1 or 0 for answers
+    qint64 latencyMs = -1;
+    int count = -1;             // E.g. the number of units at start-up
+    QString name;               // Only for curriculum edits, never on the hot paths
+};
+
+/**
+ * @brief Structured, asynchronous log of user interactions for progress analytics
+ *
+ * record() only pushes the event onto a lock-free list; it does no formatting and no
+ * I/O. A background thread wakes up periodically, takes every pending event at once and
+ * appends them as one batch of NDJSON lines (one JSON object per line). Once the file
+ * exceeds the size limit it is rotated to events.ndjson.1, .2, ... and the oldest is dropped.
+ *
+ * One instance is shared by the process (see instance()); it flushes when destroyed.
+ */
+class EventLog
+{
+public:
+    struct Stats {
+        quint64 recorded = 0;
+        quint64 written = 0;
+        quint64 batches = 0;
+        quint64 rotations = 0;
+    };
+
+    static EventLog& instance();
+
+    /**
+     * @brief Append to filePath (created if missing) and start the writer thread
+     */
+    explicit EventLog(const QString& filePath);
+    ~EventLog();
+
+    EventLog(const EventLog&) = delete;
+    EventLog& operator=(const EventLog&) = delete;
+
+    /**
+     * @brief Queue an event; safe from any thread, never blocks
+     */
+    void record(UserEvent event);
+
+    /**
+     * @brief Write everything recorded so far before returning
+     */
+    void flush();
+
+    /**
+     * @brief Rotate once the file exceeds maxFileBytes, keeping keepFiles old files
+     */
+    void setRotation(qint64 maxFileBytes, int keepFiles);
+
+    Stats stats() const;
+    const QString& path() const { return filePath; }
+
+private:
+    struct Node {
+        UserEvent event;
+        Node* next;
+    };
+
+    QString filePath;
+    QFile file;
+    std::atomic<Node*> pending{nullptr};   // Newest first
+
+    std::mutex fileMutex;                  // Held while draining, by the writer or flush()
+    std::atomic<qint64> maxFileBytes;
+    std::atomic<int> keepFiles;
+
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::thread writer;
+
+    std::atomic<quint64> recordedCount{0};
+    std::atomic<quint64> writtenCount{0};
+    std::atomic<quint64> batchCount{0};
+    std::atomic<quint64> rotationCount{0};
+
+    void run();
+    void drain();
+    void rotate();
+    static QByteArray toJsonLine(const UserEvent& event);
+};
+
+#endif // EVENTLOG_H
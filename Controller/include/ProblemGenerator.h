@@ -5,7 +5,9 @@
 #include <QString>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <functional>
 #include "AIService.h"
+#include "AiResult.h"
 #include "../Model/include/Model.h"
 
 // Struct for generated problems with optional multiple choice
@@ -21,6 +23,8 @@ struct GeneratedProblem {
         : problemStatement(statement), choices(options), isMultipleChoice(true) {}
 };
 
+struct ParsedProblem;
+
 class ProblemGenerator : public QObject
 {
     Q_OBJECT
@@ -35,13 +39,37 @@ public:
     void generateProblem();
     
     // Generate problem with specific parameters (for testing/manual use)
-    void generateProblem(const QString& problemType, const QString& difficulty);
+    void generateProblem(const QString& problemType, Difficulty difficulty);
     
     // Synchronous version that blocks and returns the generated problem
-    QString generateProblemSync(const QString& problemType, const QString& difficulty);
+    AiResult<QString> generateProblemSync(const QString& problemType, Difficulty difficulty);
     
     // Generate complete problem with multiple choice options when appropriate
-    GeneratedProblem generateCompleteProblemSync(const QString& problemType, const QString& difficulty, bool forceMultipleChoice = false);
+    AiResult<GeneratedProblem> generateCompleteProblemSync(const QString& problemType, Difficulty difficulty, bool forceMultipleChoice = false);
+    
+    // Non-blocking version of generateCompleteProblemSync. Returns a job id for cancelGeneration();
+    // the handler receives the result unless the job is cancelled first. An unparsable answer
+    // is a failure with AIStatusCode::InvalidResponse.
+    // multipleChoice is taken as-is: background callers (e.g. ProblemPool) generate for problems
+    // other than the current selection, so the selection-based heuristic does not apply here.
+    // Prefetching callers pass AIPriority::Background so they never delay what the user waits on.
+    using ProblemHandler = std::function<void(const AiResult<GeneratedProblem>&)>;
+    quint64 generateCompleteProblemAsync(const QString& problemType, Difficulty difficulty,
+                                         bool multipleChoice, ProblemHandler handler,
+                                         AIPriority priority = AIPriority::Interactive);
+    void cancelGeneration(quint64 jobId);
+    
+    // Generates up to count problems (capped at maxBatchSize()) for one topic and difficulty
+    // in a single AI request; the prompt overhead is paid once instead of per problem.
+    // Problems that fail to parse are dropped, so fewer than count may come back; a successful
+    // result always holds at least one.
+    using BatchHandler = std::function<void(const AiResult<QVector<GeneratedProblem>>&)>;
+    AiResult<QVector<GeneratedProblem>> generateBatch(const QString& problemType, Difficulty difficulty,
+                                                      int count, bool multipleChoice = true);
+    quint64 generateBatchAsync(const QString& problemType, Difficulty difficulty, int count,
+                               bool multipleChoice, BatchHandler handler,
+                               AIPriority priority = AIPriority::Background);
+    static int maxBatchSize();
 
 signals:
     void problemGenerated(const QString& problem);
@@ -56,10 +84,17 @@ private:
     Model* model;
     
     // Helper methods
-    QString createPrompt(const QString& problemType, const QString& difficulty);
-    QString createMultipleChoicePrompt(const QString& problemType, const QString& difficulty);
+    QString createPrompt(const QString& problemType, Difficulty difficulty);
+    QString createMultipleChoicePrompt(const QString& problemType, Difficulty difficulty);
+    QString createBatchPrompt(const QString& problemType, Difficulty difficulty, int count, bool multipleChoice);
     QString extractProblemFromResponse(const QString& response);
-    GeneratedProblem parseMultipleChoiceResponse(const QString& response);
+    GeneratedProblem parseMultipleChoiceResponse(const QString& response, bool allowChoices);
+    QVector<GeneratedProblem> parseBatchResponse(const QString& response, bool multipleChoice);
+    AiResult<GeneratedProblem> toProblemResult(const AiResult<QString>& response, bool multipleChoice,
+                                               bool allowChoices);
+    AiResult<QVector<GeneratedProblem>> toBatchResult(const AiResult<QString>& response, bool multipleChoice);
+    static GeneratedProblem toMultipleChoiceProblem(const ParsedProblem& parsed, bool allowChoices);
+    bool shouldGenerateMultipleChoice(Difficulty difficulty, bool forceMultipleChoice) const;
 };
 
 #endif // PROBLEMGENERATOR_H
@@ -0,0 +1,134 @@
+#ifndef PROBLEMPOOL_H
+#define PROBLEMPOOL_H
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QQueue>
+#include <QList>
+#include <QTimer>
+#include "ProblemGenerator.h"
+
+class Model;
+
+// Identifies one kind of pooled problem: the topic (interned problem name), the
+// difficulty it was generated for and whether it carries multiple choice options
+struct ProblemPoolKey {
+    TopicId topic;
+    Difficulty difficulty;
+    bool multipleChoice;
+
+    ProblemPoolKey(TopicId t = 0, Difficulty diff = Difficulty::Medium, bool mc = false)
+        : topic(t), difficulty(diff), multipleChoice(mc) {}
+
+    bool operator==(const ProblemPoolKey& other) const {
+        return topic == other.topic &&
+               difficulty == other.difficulty &&
+               multipleChoice == other.multipleChoice;
+    }
+};
+
+inline size_t qHash(const ProblemPoolKey& key, size_t seed = 0)
+{
+    return qHashMulti(seed, key.topic, int(key.difficulty), int(key.multipleChoice));
+}
+
+// Keeps a few ready-made problems per key so a selection can be served without
+// waiting for the AI backend. Keys for the user's current difficulty are refilled
+// in the background with a bounded number of concurrent requests; each request
+// generates every missing problem of a key as one batch.
+class ProblemPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Stats {
+        quint64 hits = 0;        // take() served a ready problem
+        quint64 misses = 0;      // take() found the key empty
+        quint64 generated = 0;   // Problems added to the pool
+        quint64 failures = 0;    // Background generations that failed
+        quint64 requests = 0;    // Batch requests sent to the AI backend
+        int ready = 0;           // Problems currently waiting in the pool
+        int inFlight = 0;        // Background generations currently running
+    };
+
+    explicit ProblemPool(ProblemGenerator* generator, QObject *parent = nullptr);
+
+    // Watches the model's curriculum and difficulty to decide what to prefetch
+    void setModel(Model* model);
+
+    // Number of ready problems kept per key (N)
+    void setCapacity(int problemsPerKey);
+    int capacity() const { return problemsPerKey; }
+
+    // Upper bound on background AI requests running at the same time
+    void setMaxConcurrentRequests(int maxRequests);
+
+    // Removes a ready problem for key into out. Returns false on a miss; either way
+    // the key is moved to the front of the refill queue.
+    bool take(const ProblemPoolKey& key, GeneratedProblem& out);
+    int readyCount(const ProblemPoolKey& key) const;
+
+    // Moves key to the front of the refill queue without taking anything, for a
+    // selection that was served from elsewhere but will want a fresh problem next time
+    void prefetch(const ProblemPoolKey& key);
+
+    // Someone is waiting on key after a take() miss. Reuses a generation already running
+    // for it; otherwise starts one at interactive priority, regardless of the concurrency
+    // limit and the pause after failures. The outcome arrives as problemReady or
+    // generationFailed; a difficulty change does not cancel it.
+    void request(const ProblemPoolKey& key);
+
+    Stats stats() const;
+
+    // Builds the key the Controller uses for a problem (first 3 problems of a unit are multiple choice)
+    static ProblemPoolKey keyFor(TopicId topic, Difficulty difficulty, int problemIndex);
+
+signals:
+    // A new problem for key has been added to the pool
+    void problemReady(const ProblemPoolKey& key);
+
+    // The last generation running for key produced nothing usable
+    void generationFailed(const ProblemPoolKey& key, const AIStatus& status);
+
+private slots:
+    void onUserDifficultyChanged(Difficulty difficulty);
+    void rebuildTargets();
+    void schedule();
+
+private:
+    ProblemGenerator* generator;
+    Model* model;
+
+    int problemsPerKey;
+    int maxConcurrentRequests;
+
+    struct InFlightJob {
+        ProblemPoolKey key;
+        int count = 0;           // Problems requested in the batch
+        bool requested = false;  // Someone is waiting on it (see request())
+    };
+
+    QHash<ProblemPoolKey, QQueue<GeneratedProblem>> readyProblems;
+    QHash<ProblemPoolKey, int> inFlightPerKey;   // Problems requested but not yet delivered
+    QHash<quint64, InFlightJob> inFlightJobs;    // ProblemGenerator job id -> batch
+    QList<ProblemPoolKey> targets;               // Keys to keep filled, highest priority first
+
+    // Pauses refilling for a while after failures so a dead backend is not hammered
+    QTimer retryTimer;
+
+    quint64 hitCount;
+    quint64 missCount;
+    quint64 generatedCount;
+    quint64 failureCount;
+    quint64 requestCount;
+
+    void startGeneration(const ProblemPoolKey& key, int count, AIPriority priority = AIPriority::Background,
+                         bool requested = false);
+    void onGenerationFinished(quint64 jobId, const AiResult<QVector<GeneratedProblem>>& result);
+    void releaseJob(const InFlightJob& job);
+    void prioritize(const ProblemPoolKey& key);
+    int inFlightTotal() const { return inFlightJobs.size(); }
+};
+
+#endif // PROBLEMPOOL_H
@@ -0,0 +1,84 @@
+#ifndef RESPONSEPARSER_H
+#define RESPONSEPARSER_H
+
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+#include <QVector>
+
+// One problem as written by the model, before it is turned into a GeneratedProblem
+struct ParsedProblem {
+    QString statement;
+    QStringList choices;     // Option texts in A-D order without their "A)" label; empty if none
+    int correctIndex = -1;   // Index into choices, -1 if the model did not say
+};
+
+struct ParsedGrade {
+    QString grade;           // Letter grade, e.g. "B"
+    QString feedback;
+
+    // Sections of the detailed review; empty unless the prompt asked for them
+    QString noticed;
+    QString strengths;
+    QString improvements;
+    QString nextTime;
+    QString encouragement;
+
+    bool hasDetails() const
+    {
+        return !noticed.isEmpty() || !strengths.isEmpty() || !improvements.isEmpty()
+            || !nextTime.isEmpty() || !encouragement.isEmpty();
+    }
+};
+
+/**
+ * @brief Parser for the versioned response contract of AI-generated content
+ *
+ * Prompts ask the model to answer with a single JSON object tagged with a schema id:
+ *   {"schema": "pipino.problems/1", "problems": [{"statement": "...",
+ *    "choices": ["...", "...", "...", "..."], "correct": "B"}]}
+ *   {"schema": "pipino.grade/1", "grade": "B", "feedback": "...",
+ *    "details": {"noticed": "...", "strengths": "...", "improve": "...",
+ *                "nextTime": "...", "encouragement": "..."}}
+ * "details" is optional; it is only requested when the full review is wanted as well.
+ *
+ * The JSON is scanned in place over a QStringView; only the fields that are returned
+ * are copied out, and only strings containing escapes need decoding. Responses that
+ * ignore the contract go through a tolerant fallback for the older line-based format
+ * (PROBLEM: / A) .. D) / CORRECT:), and every fallback is counted in stats().
+ */
+class ResponseParser
+{
+public:
+    static constexpr int kSchemaVersion = 1;
+
+    struct Stats {
+        quint64 structured = 0;  // Responses that followed the JSON contract
+        quint64 fallback = 0;    // Responses that had to be read by the tolerant text parser
+        quint64 failed = 0;      // Responses nothing usable could be read from
+    };
+
+    /**
+     * @brief Read every problem in a response; empty if none could be found
+     */
+    static QVector<ParsedProblem> parseProblems(QStringView response);
+
+    /**
+     * @brief Read a structured grade; false if the response does not follow the contract
+     *
+     * Does not count a fallback itself, because callers also pass responses that were
+     * never meant to be structured; use recordFallback() when one was expected.
+     */
+    static bool parseGrade(QStringView response, ParsedGrade& grade);
+    static void recordFallback();
+
+    /**
+     * @brief Output format instructions to append to a prompt
+     */
+    static QString problemFormatInstructions(int count, bool multipleChoice);
+    static QString gradeFormatInstructions(bool withDetails = false);
+
+    static Stats stats();
+};
+
+#endif // RESPONSEPARSER_H
@@ -2,8 +2,13 @@
 #define SOLUTIONGRADER_H
 
 #include <QObject>
+#include <QHash>
 #include <QString>
+#include <QStringList>
 #include "AIService.h"
+#include "AiResult.h"
+
+struct ParsedGrade;
 
 /**
  * @brief The SolutionGrader class provides AI-powered grading of user solutions
@@ -21,11 +26,16 @@ public:
     
     /**
      * @brief Grade a user's solution against a problem
+     *
+     * The same request also asks for the detailed review. Only the short grade is
+     * returned; the review is kept so a following getDetailedFeedback() for this
+     * solution is answered without another round-trip.
+     *
      * @param userSolution The user's submitted solution
      * @param problemStatement The original problem statement
-     * @return QString containing the graded feedback in chat format
+     * @return The graded feedback in chat format, or why grading failed
      */
-    QString gradeSolution(const QString& userSolution, const QString& problemStatement);
+    AiResult<QString> gradeSolution(const QString& userSolution, const QString& problemStatement);
     
     /**
      * @brief Grade a user's solution asynchronously
@@ -36,11 +46,20 @@ public:
     
     /**
      * @brief Get detailed feedback for a previously graded solution
+     *
+     * Returns the review that came with gradeSolution() if there is one; otherwise
+     * asks the AI for it.
+     *
      * @param userSolution The user's submitted solution
      * @param problemStatement The original problem statement
-     * @return QString containing detailed feedback in chat format
+     * @return Detailed feedback in chat format, or why it could not be produced
      */
-    QString getDetailedFeedback(const QString& userSolution, const QString& problemStatement);
+    AiResult<QString> getDetailedFeedback(const QString& userSolution, const QString& problemStatement);
+    
+    /**
+     * @brief Whether getDetailedFeedback() can answer from the last gradings without a request
+     */
+    bool hasDetailedFeedback(const QString& userSolution, const QString& problemStatement) const;
     
     /**
      * @brief Get detailed feedback asynchronously
@@ -48,6 +67,32 @@ public:
      * @param problemStatement The original problem statement
      */
     void getDetailedFeedbackAsync(const QString& userSolution, const QString& problemStatement);
+    
+    /**
+     * @brief Stream detailed feedback while it is being generated
+     * @param userSolution The user's submitted solution
+     * @param problemStatement The original problem statement
+     * @return Request id reported by feedbackChunk/feedbackStreamFinished
+     */
+    quint64 streamDetailedFeedback(const QString& userSolution, const QString& problemStatement);
+    
+    /**
+     * @brief Stream detailed feedback on a solution given as ordered steps (e.g. OCR lines)
+     * @param solutionSteps The student's steps, top to bottom
+     * @param problemStatement The original problem statement
+     * @return Request id reported by feedbackChunk/feedbackStreamFinished
+     */
+    quint64 streamDetailedFeedback(const QStringList& solutionSteps, const QString& problemStatement);
+    
+    /**
+     * @brief Number the steps so the AI can refer to them ("Step 2: ...")
+     */
+    static QString formatSolutionSteps(const QStringList& solutionSteps);
+    
+    /**
+     * @brief Stop a feedback stream; no further signals are emitted for it
+     */
+    void cancelStream(quint64 requestId);
 
 signals:
     /**
@@ -61,6 +106,20 @@ signals:
      * @param error The error message
      */
     void gradingError(const QString& error);
+    
+    /**
+     * @brief Emitted for each piece of streamed feedback, in order
+     * @param requestId The id returned by streamDetailedFeedback()
+     * @param chunk Newly received text, to append to what was shown so far
+     */
+    void feedbackChunk(quint64 requestId, const QString& chunk);
+    
+    /**
+     * @brief Emitted once a feedback stream ends
+     * @param requestId The id returned by streamDetailedFeedback()
+     * @param feedback The complete, formatted feedback, or why the stream failed
+     */
+    void feedbackStreamFinished(quint64 requestId, const AiResult<QString>& feedback);
 
 private slots:
     void handleAIResponse(const QString& response);
@@ -69,13 +128,21 @@ private slots:
 private:
     AIService* aiService;
     
+    // Detailed reviews that came with a grade, keyed by detailKey(); oldest dropped first
+    QHash<QString, QString> detailCache;
+    QStringList detailCacheOrder;
+    
+    static QString detailKey(const QString& userSolution, const QString& problemStatement);
+    void cacheDetailedFeedback(const QString& key, const QString& feedback);
+    
     /**
      * @brief Create a grading prompt for the AI
      * @param userSolution The user's solution
      * @param problemStatement The original problem
+     * @param withDetails Also ask for the detailed review in the same response
      * @return The formatted prompt for the AI
      */
-    QString createGradingPrompt(const QString& userSolution, const QString& problemStatement);
+    QString createGradingPrompt(const QString& userSolution, const QString& problemStatement, bool withDetails);
     
     /**
      * @brief Create a detailed feedback prompt for the AI
@@ -91,6 +158,20 @@ private:
      * @return The formatted feedback
      */
     QString extractGradingFeedback(const QString& response);
+    
+    /**
+     * @brief Format a structured grade the way the chat shows it
+     * @param grade Grade and one-line feedback parsed from the AI response
+     * @return "🎯 **Grade: X** - feedback"
+     */
+    static QString formatGrade(const ParsedGrade& grade);
+    
+    /**
+     * @brief Format the detailed sections of a structured grade as the chat review
+     * @param grade Grade and details parsed from the AI response
+     * @return The same layout the detailed feedback prompt asks for
+     */
+    static QString formatDetailedFeedback(const ParsedGrade& grade);
 };
 
 #endif // SOLUTIONGRADER_H
@@ -0,0 +1,175 @@
+#include "AIResilience.h"
+#include <QDebug>
+#include <QRandomGenerator>
+#include <algorithm>
+#include <limits>
+
+namespace {
+constexpr int kDefaultFailureThreshold = 5;
+constexpr int kDefaultOpenIntervalMs = 15000;
+constexpr int kDefaultMaxOpenIntervalMs = 120000;
+
+// Latency samples kept per endpoint, and how many are needed before the p95 is trusted
+constexpr int kLatencyWindow = 64;
+constexpr int kMinLatencySamples = 16;
+
+// Range the p95 is clamped to
+constexpr int kMinHedgeDelayMs = 250;
+constexpr int kMaxHedgeDelayMs = 8000;
+}
+
+AIRetryPolicy AIRetryPolicy::none()
+{
+    AIRetryPolicy policy;
+    policy.maxAttempts = 1;
+    return policy;
+}
+
+AIRetryPolicy AIRetryPolicy::interactive()
+{
+    // The user is waiting: retry quickly and hedge a slow first attempt
+    AIRetryPolicy policy;
+    policy.maxAttempts = 3;
+    policy.baseDelayMs = 200;
+    policy.maxDelayMs = 1000;
+    policy.hedge = true;
+    return policy;
+}
+
+AIRetryPolicy AIRetryPolicy::background()
+{
+    // Nobody is waiting: back off further and never add duplicate load
+    AIRetryPolicy policy;
+    policy.maxAttempts = 4;
+    policy.baseDelayMs = 500;
+    policy.maxDelayMs = 8000;
+    return policy;
+}
+
+AIResilience& AIResilience::instance()
+{
+    static AIResilience resilience;
+    return resilience;
+}
+
+AIResilience::AIResilience()
+    : failureThreshold(kDefaultFailureThreshold)
+    , baseOpenIntervalMs(kDefaultOpenIntervalMs)
+    , maxOpenIntervalMs(kDefaultMaxOpenIntervalMs)
+{
+}
+
+bool AIResilience::allowRequest(const QString &backend)
+{
+    auto it = breakers.find(backend);
+    if (it == breakers.end() || it->state == BreakerState::Closed) {
+        return true;
+    }
+
+    // Open, or half-open with a probe already out: let one probe through per interval.
+    // A probe whose caller went away therefore blocks the backend for one interval at most.
+    if (it->openedFor.elapsed() >= it->openIntervalMs) {
+        it->state = BreakerState::HalfOpen;
+        it->openedFor.restart();
+        qDebug() << "AIResilience: probing" << backend;
+        return true;
+    }
+
+    ++counters.shortCircuited;
+    return false;
+}
+
+void AIResilience::recordSuccess(const QString &backend, const QString &endpoint, AIPriority priority,
+                                 qint64 latencyMs)
+{
+    auto it = breakers.find(backend);
+    if (it != breakers.end()) {
+        if (it->state != BreakerState::Closed) {
+            qDebug() << "AIResilience:" << backend << "recovered, closing circuit";
+        }
+        breakers.erase(it);
+    }
+
+    LatencyWindow &window = latencies[latencyKey(endpoint, priority)];
+    int sample = int(qMin<qint64>(latencyMs, std::numeric_limits<int>::max()));
+    if (window.samples.size() < kLatencyWindow) {
+        window.samples.append(sample);
+    } else {
+        window.samples[window.next] = sample;
+    }
+    window.next = (window.next + 1) % kLatencyWindow;
+}
+
+void AIResilience::recordFailure(const QString &backend, const AIStatus &status)
+{
+    if (!status.isBackendFailure()) {
+        return;
+    }
+
+    Breaker &breaker = breakers[backend];
+    if (breaker.state == BreakerState::HalfOpen) {
+        // The probe failed: stay away for longer this time
+        breaker.openIntervalMs = qMin(breaker.openIntervalMs * 2, maxOpenIntervalMs);
+        open(breaker, backend);
+        return;
+    }
+
+    if (breaker.state == BreakerState::Closed && ++breaker.consecutiveFailures >= failureThreshold) {
+        breaker.openIntervalMs = baseOpenIntervalMs;
+        open(breaker, backend);
+    }
+}
+
+void AIResilience::open(Breaker &breaker, const QString &backend)
+{
+    breaker.state = BreakerState::Open;
+    breaker.openedFor.start();
+    ++counters.breakerOpens;
+    qDebug() << "AIResilience:" << backend << "keeps failing, failing fast for" << breaker.openIntervalMs << "ms";
+}
+
+AIResilience::BreakerState AIResilience::breakerState(const QString &backend) const
+{
+    auto it = breakers.constFind(backend);
+    return it == breakers.constEnd() ? BreakerState::Closed : it->state;
+}
+
+int AIResilience::retryDelayMs(const AIRetryPolicy &policy, int retry) const
+{
+    // Equal jitter: half the exponential step is fixed, the other half random
+    int shift = qBound(0, retry - 1, 16);
+    int cap = int(qMin<qint64>(qint64(policy.baseDelayMs) << shift, policy.maxDelayMs));
+    int half = cap / 2;
+    return half + int(QRandomGenerator::global()->bounded(cap - half + 1));
+}
+
+int AIResilience::hedgeDelayMs(const QString &endpoint, AIPriority priority) const
+{
+    auto it = latencies.constFind(latencyKey(endpoint, priority));
+    if (it == latencies.constEnd() || it->samples.size() < kMinLatencySamples) {
+        // No guess is safe: LLM answers vary from well under a second to many, and a
+        // premature hedge is a second paid request
+        return -1;
+    }
+
+    QVector<int> sorted = it->samples;
+    auto p95 = sorted.begin() + (sorted.size() * 95) / 100;
+    std::nth_element(sorted.begin(), p95, sorted.end());
+    return qBound(kMinHedgeDelayMs, *p95, kMaxHedgeDelayMs);
+}
+
+QString AIResilience::latencyKey(const QString &endpoint, AIPriority priority)
+{
+    return endpoint + '#' + QString::number(int(priority));
+}
+
+void AIResilience::setFailureThreshold(int failures)
+{
+    failureThreshold = qMax(1, failures);
+}
+
+void AIResilience::setOpenInterval(int baseMs, int maxMs)
+{
+    baseOpenIntervalMs = qMax(1, baseMs);
+    maxOpenIntervalMs = qMax(baseOpenIntervalMs, maxMs);
+}
@@ -0,0 +1,348 @@
+#include "AIResponseCache.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QPair>
+#include <QVector>
+#include <QtEndian>
+#include <algorithm>
+
+namespace {
+// Record layout (little endian):
+//   quint32 magic | quint8 keySize | key | qint64 storedAtMs | qint32 valueSize | value
+constexpr quint32 kRecordMagic = 0x50435243; // "PCRC"
+constexpr int kHeaderFixedSize = 4 + 1;
+constexpr int kTrailerFixedSize = 8 + 4;
+
+constexpr qint64 kDefaultTtlMs = 7LL * 24 * 60 * 60 * 1000; // One week
+constexpr qint64 kDefaultMaxBytes = 32LL * 1024 * 1024;    // 32 MB of responses
+constexpr qint64 kCompactionSlackBytes = 1024 * 1024;       // Ignore dead data below 1 MB
+
+QByteArray encodeRecord(const QByteArray& key, const QByteArray& value, qint64 storedAtMs)
+{
+    QByteArray record;
+    record.reserve(kHeaderFixedSize + key.size() + kTrailerFixedSize + value.size());
+
+    char buffer[8];
+    qToLittleEndian<quint32>(kRecordMagic, buffer);
+    record.append(buffer, 4);
+    record.append(char(key.size()));
+    record.append(key);
+    qToLittleEndian<qint64>(storedAtMs, buffer);
+    record.append(buffer, 8);
+    qToLittleEndian<qint32>(qint32(value.size()), buffer);
+    record.append(buffer, 4);
+    record.append(value);
+    return record;
+}
+}
+
+AIResponseCache& AIResponseCache::instance()
+{
+    static AIResponseCache cache([] {
+        QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+        QDir().mkpath(dir);
+        return dir + "/ai_response_cache.log";
+    }());
+    return cache;
+}
+
+AIResponseCache::AIResponseCache(const QString& path)
+    : filePath(path)
+    , file(path)
+    , ttlMs(kDefaultTtlMs)
+    , maxBytes(kDefaultMaxBytes)
+    , liveBytes(0)
+    , useClock(0)
+    , hitCount(0)
+    , missCount(0)
+    , evictionCount(0)
+{
+    if (!file.open(QIODevice::ReadWrite)) {
+        qWarning() << "AIResponseCache: could not open" << filePath << "-" << file.errorString();
+        return;
+    }
+    loadIndex();
+}
+
+AIResponseCache::~AIResponseCache()
+{
+    file.close();
+}
+
+QByteArray AIResponseCache::makeKey(const QString& endpoint, const QByteArray& payload)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    hash.addData(endpoint.toUtf8());
+    hash.addData(QByteArray(1, '\0'));
+    hash.addData(payload);
+    return hash.result();
+}
+
+bool AIResponseCache::lookup(const QByteArray& key, QString& response, bool allowExpired)
+{
+    QMutexLocker locker(&mutex);
+
+    auto it = index.find(key);
+    if (it == index.end()) {
+        ++missCount;
+        return false;
+    }
+
+    if (!allowExpired && isExpired(*it, QDateTime::currentMSecsSinceEpoch())) {
+        ++missCount;
+        return false;
+    }
+
+    QByteArray value;
+    if (!readValue(*it, value)) {
+        removeEntry(key);
+        ++missCount;
+        return false;
+    }
+
+    it->lastUsed = ++useClock;
+    ++hitCount;
+    response = QString::fromUtf8(value);
+    return true;
+}
+
+void AIResponseCache::store(const QByteArray& key, const QString& response)
+{
+    QMutexLocker locker(&mutex);
+
+    if (!file.isOpen()) return;
+
+    QByteArray value = response.toUtf8();
+    if (value.size() > maxBytes) return; // Would evict everything else
+
+    Entry entry;
+    if (!appendRecord(key, value, QDateTime::currentMSecsSinceEpoch(), entry)) {
+        return;
+    }
+
+    // A newer record for the same key makes the previous one dead
+    removeEntry(key);
+    entry.lastUsed = ++useClock;
+    index.insert(key, entry);
+    liveBytes += entry.valueSize;
+
+    evictIfNeeded();
+    compactIfNeeded();
+}
+
+void AIResponseCache::clear()
+{
+    QMutexLocker locker(&mutex);
+
+    index.clear();
+    liveBytes = 0;
+    if (file.isOpen()) {
+        file.resize(0);
+    }
+}
+
+void AIResponseCache::setTimeToLive(qint64 seconds)
+{
+    QMutexLocker locker(&mutex);
+    ttlMs = seconds * 1000;
+}
+
+void AIResponseCache::setMaxBytes(qint64 bytes)
+{
+    QMutexLocker locker(&mutex);
+    maxBytes = bytes;
+    evictIfNeeded();
+    compactIfNeeded();
+}
+
+AIResponseCache::Stats AIResponseCache::stats() const
+{
+    QMutexLocker locker(&mutex);
+
+    Stats s;
+    s.hits = hitCount;
+    s.misses = missCount;
+    s.evictions = evictionCount;
+    s.entries = index.size();
+    s.liveBytes = liveBytes;
+    s.fileBytes = file.isOpen() ? file.size() : 0;
+    return s;
+}
+
+void AIResponseCache::loadIndex()
+{
+    const qint64 fileSize = file.size();
+    qint64 offset = 0;
+
+    file.seek(0);
+    while (offset + kHeaderFixedSize <= fileSize) {
+        char header[kHeaderFixedSize];
+        if (file.read(header, kHeaderFixedSize) != kHeaderFixedSize ||
+            qFromLittleEndian<quint32>(header) != kRecordMagic) {
+            break;
+        }
+
+        int keySize = quint8(header[4]);
+        QByteArray key = file.read(keySize);
+        char trailer[kTrailerFixedSize];
+        if (key.size() != keySize || file.read(trailer, kTrailerFixedSize) != kTrailerFixedSize) {
+            break;
+        }
+
+        Entry entry;
+        entry.storedAtMs = qFromLittleEndian<qint64>(trailer);
+        entry.valueSize = qFromLittleEndian<qint32>(trailer + 8);
+        entry.valueOffset = offset + kHeaderFixedSize + keySize + kTrailerFixedSize;
+
+        qint64 recordEnd = entry.valueOffset + entry.valueSize;
+        if (entry.valueSize < 0 || recordEnd > fileSize) {
+            break;
+        }
+
+        // Later records win; file order approximates recency. Expired entries are kept
+        // as stale, so the offline fallback still has them after a restart.
+        removeEntry(key);
+        entry.lastUsed = ++useClock;
+        index.insert(key, entry);
+        liveBytes += entry.valueSize;
+
+        offset = recordEnd;
+        file.seek(offset);
+    }
+
+    // Drop a torn record left behind by a crash mid-append
+    if (offset < fileSize) {
+        qWarning() << "AIResponseCache: truncating corrupt tail at offset" << offset;
+        file.resize(offset);
+    }
+
+    qDebug() << "AIResponseCache: loaded" << index.size() << "entries from" << filePath;
+
+    evictIfNeeded();
+    compactIfNeeded();
+}
+
+bool AIResponseCache::appendRecord(const QByteArray& key, const QByteArray& value, qint64 storedAtMs, Entry& entry)
+{
+    QByteArray record = encodeRecord(key, value, storedAtMs);
+    qint64 offset = file.size();
+
+    if (!file.seek(offset) || file.write(record) != record.size()) {
+        qWarning() << "AIResponseCache: write failed -" << file.errorString();
+        file.resize(offset);
+        return false;
+    }
+    file.flush();
+
+    entry.valueOffset = offset + record.size() - value.size();
+    entry.valueSize = qint32(value.size());
+    entry.storedAtMs = storedAtMs;
+    return true;
+}
+
+bool AIResponseCache::readValue(const Entry& entry, QByteArray& value)
+{
+    if (!file.seek(entry.valueOffset)) {
+        return false;
+    }
+    value = file.read(entry.valueSize);
+    return value.size() == entry.valueSize;
+}
+
+void AIResponseCache::removeEntry(const QByteArray& key)
+{
+    auto it = index.find(key);
+    if (it != index.end()) {
+        liveBytes -= it->valueSize;
+        index.erase(it);
+    }
+}
+
+void AIResponseCache::evictIfNeeded()
+{
+    if (liveBytes <= maxBytes) return;
+
+    // Evict down to 90% of the cap to avoid evicting on every store: stale entries first,
+    // only useful while the backend is down, then the least recently used fresh ones
+    const qint64 nowMs = QDateTime::currentMSecsSinceEpoch();
+    QVector<QPair<QPair<bool, quint64>, QByteArray>> byAge;
+    byAge.reserve(index.size());
+    for (auto it = index.cbegin(); it != index.cend(); ++it) {
+        byAge.append({{!isExpired(*it, nowMs), it->lastUsed}, it.key()});
+    }
+    std::sort(byAge.begin(), byAge.end());
+
+    const qint64 target = maxBytes - maxBytes / 10;
+    for (const auto& item : std::as_const(byAge)) {
+        if (liveBytes <= target) break;
+        removeEntry(item.second);
+        ++evictionCount;
+    }
+}
+
+void AIResponseCache::compactIfNeeded()
+{
+    const qint64 fileSize = file.size();
+    if (fileSize - liveBytes < kCompactionSlackBytes || fileSize < 2 * liveBytes) {
+        return;
+    }
+
+    // Rewrite live entries oldest-first so the reloaded LRU order matches the current one
+    QVector<QPair<quint64, QByteArray>> byAge;
+    byAge.reserve(index.size());
+    for (auto it = index.cbegin(); it != index.cend(); ++it) {
+        byAge.append({it->lastUsed, it.key()});
+    }
+    std::sort(byAge.begin(), byAge.end());
+
+    QSaveFile output(filePath + ".compact");
+    if (!output.open(QIODevice::WriteOnly)) {
+        return;
+    }
+
+    QHash<QByteArray, Entry> compacted;
+    qint64 offset = 0;
+    for (const auto& item : std::as_const(byAge)) {
+        Entry entry = index.value(item.second);
+        QByteArray value;
+        if (!readValue(entry, value)) continue;
+
+        QByteArray record = encodeRecord(item.second, value, entry.storedAtMs);
+        output.write(record);
+        entry.valueOffset = offset + record.size() - value.size();
+        offset += record.size();
+        compacted.insert(item.second, entry);
+    }
+
+    if (!output.commit()) {
+        return;
+    }
+
+    file.close();
+    QFile::remove(filePath);
+    QFile::rename(filePath + ".compact", filePath);
+    if (!file.open(QIODevice::ReadWrite)) {
+        qWarning() << "AIResponseCache: could not reopen" << filePath << "after compaction";
+        index.clear();
+        liveBytes = 0;
+        return;
+    }
+
+    index = compacted;
+    liveBytes = 0;
+    for (const Entry& entry : std::as_const(index)) {
+        liveBytes += entry.valueSize;
+    }
+    qDebug() << "AIResponseCache: compacted" << fileSize << "->" << file.size() << "bytes";
+}
+
+bool AIResponseCache::isExpired(const Entry& entry, qint64 nowMs) const
+{
+    return ttlMs > 0 && nowMs - entry.storedAtMs > ttlMs;
+}
@@ -1,4 +1,6 @@
 #include "AIService.h"
+#include "AIResponseCache.h"
+#include "Trace.h"
 #include <QUrlQuery>
 #include <QJsonArray>
 #include <QJsonDocument>
@@ -9,21 +11,112 @@
 #include <QHttpMultiPart>
 #include <QFileInfo>
 #include <QFile>
+#include <QStringDecoder>
+#include <QSettings>
+#include <memory>
 
-AIService::AIService(QObject *parent) : QObject(parent)
+namespace {
+// prompt(), chat() and friends have no caller-supplied timeout. Generous, so a slow
+// answer still arrives, but bounded so a hung backend trips the circuit breaker.
+constexpr int kDefaultCallTimeoutMs = 30000;
+
+QString &baseUrlOverride()
 {
-    manager = new QNetworkAccessManager(this);
+    static QString url;
+    return url;
+}
 }
 
-void AIService::prompt(const QString &message)
+AIService::AIService(QObject *parent) : QObject(parent), baseUrl(defaultBaseUrl())
+{
+    // All services share one transport, so the backend connection is opened once per process
+    AITransport::instance().preconnect(QUrl(baseUrl));
+}
+
+void AIService::setDefaultBaseUrl(const QString &url)
+{
+    baseUrlOverride() = url;
+}
+
+QString AIService::defaultBaseUrl()
+{
+    if (!baseUrlOverride().isEmpty()) {
+        return baseUrlOverride();
+    }
+    return QSettings().value("ai/baseUrl", "http://localhost:3000/genai").toString();
+}
+
+void AIService::setPriority(AIPriority priority)
+{
+    requestPriority = priority;
+}
+
+AIPriority AIService::priority() const
+{
+    return requestPriority;
+}
+
+void AIService::setCacheBypass(bool bypass)
+{
+    bypassCache = bypass;
+}
+
+bool AIService::cacheBypass() const
+{
+    return bypassCache;
+}
+
+bool AIService::lookupCache(const QByteArray &cacheKey, QString &response) const
+{
+    return !bypassCache && AIResponseCache::instance().lookup(cacheKey, response);
+}
+
+bool AIService::lookupFallback(const QByteArray &cacheKey, QString &response) const
+{
+    // Any earlier answer, even an expired one, beats an error when the backend is unreachable
+    if (AIResponseCache::instance().lookup(cacheKey, response, true)) {
+        qDebug() << "AIService: backend unavailable, serving cached response";
+        return true;
+    }
+    return false;
+}
+
+QNetworkRequest AIService::messageRequest(const QString &endpoint, const QString &message) const
 {
-    QUrl url(baseUrl + "/prompt");
+    QUrl url(baseUrl + endpoint);
     QUrlQuery query;
     query.addQueryItem("message", message);
     url.setQuery(query);
+    return QNetworkRequest(url);
+}
 
-    QNetworkReply *reply = manager->get(QNetworkRequest(url));
-    connect(reply, &QNetworkReply::finished, [=]() { handleReply(reply); });
+bool AIService::applyFallback(const QByteArray &cacheKey, QString &response, AIStatus &status) const
+{
+    if (!lookupFallback(cacheKey, response)) {
+        return false;
+    }
+    // Usable, but the caller can still see that the backend failed and why
+    status.code = AIStatusCode::Ok;
+    status.stale = true;
+    status.fromCache = true;
+    return true;
+}
+
+void AIService::prompt(const QString &message)
+{
+    QByteArray cacheKey = AIResponseCache::makeKey("/prompt", message.toUtf8());
+    QString cached;
+    if (lookupCache(cacheKey, cached)) {
+        // Keep the signal asynchronous, as callers connect after calling prompt()
+        QTimer::singleShot(0, this, [this, cached]() { emit finished(cached); });
+        return;
+    }
+
+    startCall(nextRequestId++,
+              makeCall(messageRequest("/prompt", message), requestPriority, kDefaultCallTimeoutMs, coalesceKey(cacheKey)),
+              [this, cacheKey](const QByteArray &body, const AIStatus &status) {
+                  handleResult(body, status, cacheKey);
+              });
 }
 
 void AIService::chat(const QJsonArray &messages)
@@ -34,183 +127,595 @@ void AIService::chat(const QJsonArray &messages)
 
     QJsonObject payload;
     payload["messages"] = messages;
+    QByteArray body = QJsonDocument(payload).toJson(QJsonDocument::Compact);
+
+    QByteArray cacheKey = AIResponseCache::makeKey("/chat", body);
+    QString cached;
+    if (lookupCache(cacheKey, cached)) {
+        QTimer::singleShot(0, this, [this, cached]() { emit finished(cached); });
+        return;
+    }
 
-    QNetworkReply *reply = manager->post(request, QJsonDocument(payload).toJson());
-    connect(reply, &QNetworkReply::finished, [=]() { handleReply(reply); });
+    Call call = makeCall(request, requestPriority, kDefaultCallTimeoutMs, coalesceKey(cacheKey));
+    call.post = true;
+    call.postBody = body;
+    startCall(nextRequestId++, std::move(call), [this, cacheKey](const QByteArray &response, const AIStatus &status) {
+        handleResult(response, status, cacheKey);
+    });
 }
 
 void AIService::embeddings(const QString &text)
 {
-    QUrl url(baseUrl + "/embeddings");
-    QUrlQuery query;
-    query.addQueryItem("message", text);
-    url.setQuery(query);
-
-    QNetworkReply *reply = manager->get(QNetworkRequest(url));
-    connect(reply, &QNetworkReply::finished, [=]() { handleReply(reply); });
+    startCall(nextRequestId++,
+              makeCall(messageRequest("/embeddings", text), requestPriority, kDefaultCallTimeoutMs,
+                       AIResponseCache::makeKey("/embeddings", text.toUtf8())),
+              [this](const QByteArray &body, const AIStatus &status) {
+                  handleResult(body, status, QByteArray());
+              });
 }
 
 void AIService::rag(const QString &queryText)
 {
-    QUrl url(baseUrl + "/rag");
-    QUrlQuery query;
-    query.addQueryItem("message", queryText);
-    url.setQuery(query);
+    startCall(nextRequestId++,
+              makeCall(messageRequest("/rag", queryText), requestPriority, kDefaultCallTimeoutMs,
+                       AIResponseCache::makeKey("/rag", queryText.toUtf8())),
+              [this](const QByteArray &body, const AIStatus &status) {
+                  handleResult(body, status, QByteArray());
+              });
+}
 
-    QNetworkReply *reply = manager->get(QNetworkRequest(url));
-    connect(reply, &QNetworkReply::finished, [=]() { handleReply(reply); });
+AiResult<QString> AIService::promptSync(const QString &message, int timeoutMs)
+{
+    QByteArray cacheKey = AIResponseCache::makeKey("/prompt", message.toUtf8());
+    QString cached;
+    if (lookupCache(cacheKey, cached)) {
+        qDebug() << "AIService Sync Response served from cache";
+        AIStatus status;
+        status.fromCache = true;
+        status.bytes = cached.size();
+        return AiResult<QString>::success(cached, status);
+    }
+
+    QEventLoop loop;
+    QByteArray body;
+    AIStatus status;
+    bool finished = false;
+
+    const quint64 callId = nextRequestId++;
+    startCall(callId,
+              makeCall(messageRequest("/prompt", message), AIPriority::Interactive, timeoutMs, coalesceKey(cacheKey)),
+              [&](const QByteArray &callBody, const AIStatus &callStatus) {
+                  body = callBody;
+                  status = callStatus;
+                  finished = true;
+                  loop.quit();
+              });
+
+    // Block until the call succeeds, runs out of attempts or hits its deadline
+    if (!finished) {
+        loop.exec();
+    }
+    if (!finished) {
+        cancel(callId); // Loop quit by someone else, e.g. application exit; drops the handler too
+        status = AIStatus::failure(AIStatusCode::Cancelled, "Request cancelled");
+    }
+
+    QString result;
+    if (status.ok()) {
+        result = QString(body);
+        AIResponseCache::instance().store(cacheKey, result);
+    } else if (!applyFallback(cacheKey, result, status)) {
+        qDebug() << "AIService Sync Error:" << status.message;
+        return AiResult<QString>::failure(status);
+    }
+    qDebug() << "AIService Sync Response:" << result;
+    return AiResult<QString>::success(result, status);
 }
 
-QString AIService::promptSync(const QString &message, int timeoutMs)
+quint64 AIService::promptAsync(const QString &message, ResponseHandler handler, int timeoutMs,
+                               AIPriority priority)
 {
-    QUrl url(baseUrl + "/prompt");
-    QUrlQuery query;
-    query.addQueryItem("message", message);
-    url.setQuery(query);
+    const quint64 requestId = nextRequestId++;
+
+    QByteArray cacheKey = AIResponseCache::makeKey("/prompt", message.toUtf8());
+    QString cached;
+    if (lookupCache(cacheKey, cached)) {
+        // Delivered from the event loop like a network reply; the empty call keeps cancel() working
+        calls.insert(requestId, Call());
+        QTimer::singleShot(0, this, [this, requestId, cached, handler]() {
+            if (calls.remove(requestId) == 0) return;
+            AIStatus status;
+            status.fromCache = true;
+            status.bytes = cached.size();
+            if (handler) handler(AiResult<QString>::success(cached, status));
+        });
+        return requestId;
+    }
+
+    startCall(requestId,
+              makeCall(messageRequest("/prompt", message), priority, timeoutMs, coalesceKey(cacheKey)),
+              [this, cacheKey, handler](const QByteArray &body, const AIStatus &callStatus) {
+                  AIStatus status = callStatus;
+                  QString result;
+                  if (status.ok()) {
+                      result = QString(body);
+                      AIResponseCache::instance().store(cacheKey, result);
+                  } else if (!applyFallback(cacheKey, result, status)) {
+                      qDebug() << "AIService Async Error:" << status.message;
+                  }
+
+                  if (handler) {
+                      handler(status.ok() ? AiResult<QString>::success(result, status)
+                                          : AiResult<QString>::failure(status));
+                  }
+              });
+
+    return requestId;
+}
+
+quint64 AIService::stream(const QString &message, int timeoutMs)
+{
+    const quint64 requestId = nextRequestId++;
+
+    // Same generation as /prompt, so both endpoints share cache entries
+    QByteArray cacheKey = AIResponseCache::makeKey("/prompt", message.toUtf8());
+    QString cached;
+    if (lookupCache(cacheKey, cached)) {
+        pendingRequests.insert(requestId, 0);
+        QTimer::singleShot(0, this, [this, requestId, cached]() {
+            if (pendingRequests.remove(requestId) == 0) return;
+            AIStatus status;
+            status.fromCache = true;
+            status.bytes = cached.size();
+            emit chunkReceived(requestId, cached);
+            emit streamFinished(requestId, AiResult<QString>::success(cached, status));
+        });
+        return requestId;
+    }
+
+    if (!AIResilience::instance().allowRequest(baseUrl)) {
+        // Fail fast while the backend is down, with whatever was cached before
+        pendingRequests.insert(requestId, 0);
+        QTimer::singleShot(0, this, [this, requestId, cacheKey]() {
+            if (pendingRequests.remove(requestId) == 0) return;
+            AIStatus status = AIStatus::failure(AIStatusCode::CircuitOpen, "AI service unavailable");
+            QString result;
+            if (applyFallback(cacheKey, result, status)) {
+                emit chunkReceived(requestId, result);
+                emit streamFinished(requestId, AiResult<QString>::success(result, status));
+            } else {
+                emit streamFinished(requestId, AiResult<QString>::failure(status));
+            }
+        });
+        return requestId;
+    }
+
+    // The transfer timeout restarts with every chunk, so it only fires if the stream stalls
+    QNetworkRequest request = messageRequest("/stream", message);
+    request.setTransferTimeout(timeoutMs);
+
+    // A multi-byte UTF-8 character can straddle two network reads; the decoder keeps the partial bytes
+    auto decoder = std::make_shared<QStringDecoder>(QStringDecoder::Utf8);
+    auto received = std::make_shared<QString>();
+    auto started = std::make_shared<QElapsedTimer>();
+    started->start();
+
+    auto readChunk = [this, requestId, decoder, received](QNetworkReply *reply) {
+        QString chunk = decoder->decode(reply->readAll());
+        if (!chunk.isEmpty()) {
+            received->append(chunk);
+            emit chunkReceived(requestId, chunk);
+        }
+    };
+
+    quint64 ticket = AITransport::instance().getStream(request, requestPriority, this,
+        [this, requestId, cacheKey, decoder, received, started, endpoint = request.url().path(),
+         priority = requestPriority](QNetworkReply *reply, const QByteArray &rest) {
+            if (pendingRequests.remove(requestId) == 0) {
+                return;
+            }
+
+            AIStatus status = AIStatus::fromReply(reply);
+            status.attempts = 1;
+            status.elapsedMs = started->elapsed();
+            recordOutcome(endpoint, priority, status, status.elapsedMs);
+            PIPINO_TRACE_ELAPSED("ai", "AIService::stream", started->nsecsElapsed());
+
+            QString result;
+            if (status.ok()) {
+                // Whatever arrived after the last readyRead
+                QString chunk = decoder->decode(rest);
+                if (!chunk.isEmpty()) {
+                    received->append(chunk);
+                    emit chunkReceived(requestId, chunk);
+                }
+                result = *received;
+                status.bytes = result.toUtf8().size();
+                AIResponseCache::instance().store(cacheKey, result);
+            } else if (!applyFallback(cacheKey, result, status)) {
+                qDebug() << "AIService Stream Error:" << status.message;
+                emit streamFinished(requestId, AiResult<QString>::failure(status));
+                return;
+            }
+            emit streamFinished(requestId, AiResult<QString>::success(result, status));
+        },
+        readChunk);
+    pendingRequests.insert(requestId, ticket);
+
+    return requestId;
+}
+
+void AIService::cancel(quint64 requestId)
+{
+    auto callIt = calls.find(requestId);
+    if (callIt != calls.end()) {
+        Call call = std::move(callIt.value());
+        calls.erase(callIt);
+        abortAttempts(call); // Pending retry and hedge timers find the call gone and do nothing
+        return;
+    }
+
+    auto it = pendingRequests.find(requestId);
+    if (it == pendingRequests.end()) {
+        return;
+    }
+    quint64 ticket = it.value();
+    pendingRequests.erase(it);
+    if (ticket != 0) {
+        AITransport::instance().abort(ticket); // Dequeued, or aborted without running the handler
+    }
+}
+
+AIService::Call AIService::makeCall(const QNetworkRequest &request, AIPriority priority, int timeoutMs,
+                                    const QByteArray &coalesce) const
+{
+    Call call;
+    call.request = request;
+    call.priority = priority;
+    call.timeoutMs = timeoutMs;
+    call.coalesceKey = coalesce;
+    switch (priority) {
+    case AIPriority::Interactive:
+        call.policy = AIRetryPolicy::interactive();
+        break;
+    case AIPriority::Normal:
+        call.policy = AIRetryPolicy();
+        break;
+    case AIPriority::Background:
+        call.policy = AIRetryPolicy::background();
+        break;
+    }
+    return call;
+}
+
+void AIService::startCall(quint64 callId, Call call, CallHandler handler)
+{
+    call.handler = std::move(handler);
+    call.elapsed.start();
+    const int timeoutMs = call.timeoutMs;
+    calls.insert(callId, std::move(call));
+    PIPINO_TRACE_COUNTER("ai", "AIService calls in flight", calls.size());
+
+    if (!AIResilience::instance().allowRequest(baseUrl)) {
+        // Reported from the event loop like any other outcome, so callers have one code path
+        QTimer::singleShot(0, this, [this, callId]() {
+            finishCall(callId, QByteArray(),
+                       AIStatus::failure(AIStatusCode::CircuitOpen, "AI service unavailable, not retrying for now"));
+        });
+        return;
+    }
+
+    // The deadline covers every attempt, so retries never stretch the caller's wait
+    QTimer::singleShot(timeoutMs, this, [this, callId, timeoutMs]() {
+        if (!calls.contains(callId)) return;
+        finishCall(callId, QByteArray(),
+                   AIStatus::failure(AIStatusCode::Timeout,
+                                     QString("No response from AI service within %1ms").arg(timeoutMs)));
+    });
+
+    sendAttempt(callId, false);
+}
+
+void AIService::sendAttempt(quint64 callId, bool hedge)
+{
+    auto it = calls.find(callId);
+    if (it == calls.end()) {
+        return;
+    }
+    Call &call = it.value();
+
+    QNetworkRequest request = call.request;
+    request.setTransferTimeout(qMax(1, call.timeoutMs - int(call.elapsed.elapsed())));
+
+    // The ticket is only known once the transport returns; the handler always runs later
+    auto ticket = std::make_shared<quint64>(0);
+    auto onFinished = [this, callId, ticket](QNetworkReply *reply, const QByteArray &body) {
+        onAttemptFinished(callId, *ticket, reply, body);
+    };
 
-    QNetworkReply *reply = manager->get(QNetworkRequest(url));
+    // A hedge must not coalesce with the very request it is racing
+    const QByteArray coalesce = hedge ? QByteArray() : call.coalesceKey;
+    AITransport &transport = AITransport::instance();
+    *ticket = call.post ? transport.post(request, call.postBody, call.priority, this, onFinished, coalesce)
+                        : transport.get(request, call.priority, this, onFinished, coalesce);
+
+    ++call.attempts;
+    call.attemptsInFlight.insert(*ticket, call.elapsed.elapsed());
+
+    if (hedge) {
+        call.hedged = true;
+        call.hedgeTicket = *ticket;
+        AIResilience::instance().countHedge();
+        return;
+    }
+
+    if (call.policy.hedge && !call.hedged) {
+        const int attempt = call.attempts;
+        const int delayMs = AIResilience::instance().hedgeDelayMs(request.url().path(), call.priority);
+        if (delayMs < 0) {
+            return; // The endpoint's latency is not known yet
+        }
+        QTimer::singleShot(delayMs, this, [this, callId, attempt]() {
+            auto it = calls.find(callId);
+            // Only while the attempt that armed the timer is still the latest one and unanswered
+            if (it == calls.end() || it->hedged || it->attempts != attempt || it->attemptsInFlight.isEmpty()) {
+                return;
+            }
+            // A struggling backend does not need twice the load
+            if (AIResilience::instance().breakerState(baseUrl) != AIResilience::BreakerState::Closed) {
+                return;
+            }
+            sendAttempt(callId, true);
+        });
+    }
+}
+
+void AIService::onAttemptFinished(quint64 callId, quint64 ticket, QNetworkReply *reply, const QByteArray &body)
+{
+    auto it = calls.find(callId);
+    if (it == calls.end()) {
+        return;
+    }
+    Call &call = it.value();
+    const qint64 startedAt = call.attemptsInFlight.take(ticket);
+    PIPINO_TRACE_ELAPSED("ai", "AIService::attempt", (call.elapsed.elapsed() - startedAt) * 1000000);
+
+    AIStatus status = AIStatus::fromReply(reply);
+    AIResilience &resilience = AIResilience::instance();
+
+    if (status.ok()) {
+        resilience.recordSuccess(baseUrl, call.request.url().path(), call.priority, call.elapsed.elapsed() - startedAt);
+        if (ticket == call.hedgeTicket) {
+            resilience.countHedgeWin();
+        }
+        finishCall(callId, body, status);
+        return;
+    }
+
+    // Counted towards the breaker once, when the whole call has failed (see finishCall)
+    call.lastFailure = status;
+    qDebug() << "AIService: attempt" << call.attempts << "failed:" << status.message;
+
+    if (!call.attemptsInFlight.isEmpty()) {
+        return; // The other attempt of a hedged pair may still answer
+    }
+
+    if (status.isRetryable() && call.attempts < call.policy.maxAttempts) {
+        const int delayMs = resilience.retryDelayMs(call.policy, call.attempts);
+        if (call.elapsed.elapsed() + delayMs < call.timeoutMs) {
+            resilience.countRetry();
+            QTimer::singleShot(delayMs, this, [this, callId]() {
+                if (!calls.contains(callId)) return;
+                if (!AIResilience::instance().allowRequest(baseUrl)) {
+                    finishCall(callId, QByteArray(),
+                               AIStatus::failure(AIStatusCode::CircuitOpen, "AI service unavailable, not retrying for now"));
+                    return;
+                }
+                sendAttempt(callId, false);
+            });
+            return;
+        }
+    }
+
+    finishCall(callId, QByteArray(), status);
+}
+
+void AIService::finishCall(quint64 callId, const QByteArray &body, AIStatus status)
+{
+    auto it = calls.find(callId);
+    if (it == calls.end()) {
+        return;
+    }
+    Call call = std::move(it.value());
+    calls.erase(it);
+    PIPINO_TRACE_ELAPSED("ai", "AIService::call", call.elapsed.nsecsElapsed());
+    PIPINO_TRACE_COUNTER("ai", "AIService calls in flight", calls.size());
+
+    // The losing attempt of a hedged pair, or one cut off by the deadline
+    abortAttempts(call);
+
+    // One outcome per logical call, however many attempts it took. A call that ends
+    // short-circuited after a failed attempt still reports that backend failure.
+    if (!status.ok()) {
+        AIResilience::instance().recordFailure(baseUrl, status.isBackendFailure() ? status : call.lastFailure);
+    }
+
+    status.attempts = call.attempts;
+    status.hedged = call.hedged;
+    status.elapsedMs = call.elapsed.elapsed();
+    status.bytes = body.size();
+    if (call.handler) {
+        call.handler(body, status);
+    }
+}
+
+void AIService::abortAttempts(const Call &call)
+{
+    for (auto it = call.attemptsInFlight.constBegin(); it != call.attemptsInFlight.constEnd(); ++it) {
+        AITransport::instance().abort(it.key());
+    }
+}
+
+void AIService::recordOutcome(const QString &endpoint, AIPriority priority, const AIStatus &status,
+                              qint64 latencyMs)
+{
+    if (status.ok()) {
+        AIResilience::instance().recordSuccess(baseUrl, endpoint, priority, latencyMs);
+    } else {
+        AIResilience::instance().recordFailure(baseUrl, status);
+    }
+}
+
+AiResult<QString> AIService::waitForReply(const std::function<quint64(AITransport::ReplyHandler)> &send,
+                                          AIPriority priority, int timeoutMs, const QString &serviceName)
+{
+    PIPINO_TRACE_SCOPE("ai", "AIService::waitForReply");
     
     // Create event loop to wait for response
     QEventLoop loop;
     QTimer timer;
     timer.setSingleShot(true);
+    QElapsedTimer elapsed;
+    elapsed.start();
     
-    QString result;
+    AiResult<QString> result = AiResult<QString>::failure(AIStatusCode::Cancelled, "Request cancelled");
     bool finished = false;
     
-    // Connect to handle successful response
-    connect(reply, &QNetworkReply::finished, [&]() {
-        if (reply->error() == QNetworkReply::NoError) {
-            QByteArray response = reply->readAll();
-            result = QString(response);
-            qDebug() << "AIService Sync Response:" << result;
+    quint64 ticket = send([&](QNetworkReply *reply, const QByteArray &body) {
+        AIStatus status = AIStatus::fromReply(reply);
+        status.attempts = 1;
+        status.elapsedMs = elapsed.elapsed();
+        status.bytes = body.size();
+        recordOutcome(reply->request().url().path(), priority, status, status.elapsedMs);
+        if (status.ok()) {
+            result = AiResult<QString>::success(QString(body), status);
         } else {
-            result = QString("Error: %1").arg(reply->errorString());
-            qDebug() << "AIService Sync Error:" << reply->errorString();
+            result = AiResult<QString>::failure(status);
+            qDebug() << "AIService Sync Error:" << status.message;
         }
         finished = true;
         loop.quit();
     });
     
     // Connect timeout handler
-    connect(&timer, &QTimer::timeout, [&]() {
-        result = "Timeout: No response from AI service within " + QString::number(timeoutMs) + "ms";
+    connect(&timer, &QTimer::timeout, &loop, [&]() {
+        // Dropping the ticket also drops the handler, so nothing touches these locals afterwards
+        AITransport::instance().abort(ticket);
+        AIStatus status = AIStatus::failure(AIStatusCode::Timeout, "No response from " + serviceName + " within " +
+                                            QString::number(timeoutMs) + "ms");
+        status.attempts = 1;
+        status.elapsedMs = elapsed.elapsed();
+        AIResilience::instance().recordFailure(baseUrl, status);
+        result = AiResult<QString>::failure(status);
         qDebug() << "AIService Sync Timeout";
         finished = true;
-        reply->abort(); // Cancel the request
         loop.quit();
     });
     
-    // Start timeout timer
-    timer.start(timeoutMs);
-    
     // Block until response or timeout
+    timer.start(timeoutMs);
     if (!finished) {
         loop.exec();
     }
-    
-    reply->deleteLater();
+    if (!finished) {
+        AITransport::instance().abort(ticket); // Loop quit by someone else, e.g. application exit
+    }
     return result;
 }
 
-void AIService::handleReply(QNetworkReply *reply)
+QByteArray AIService::coalesceKey(const QByteArray &cacheKey) const
 {
-    if(reply->error() == QNetworkReply::NoError)
+    // Callers that bypass the cache want a fresh answer each time, so they must not share one
+    return bypassCache ? QByteArray() : cacheKey;
+}
+
+void AIService::handleResult(const QByteArray &body, const AIStatus &status, const QByteArray &cacheKey)
+{
+    QString cached;
+    
+    if (status.ok())
     {
         // Success case - only emit finished signal
-        QByteArray response = reply->readAll();
-        emit finished(QString(response));
+        if (!cacheKey.isEmpty()) {
+            AIResponseCache::instance().store(cacheKey, QString(body));
+        }
+        emit finished(QString(body));
+    }
+    else if (!cacheKey.isEmpty() && lookupFallback(cacheKey, cached))
+    {
+        emit finished(cached);
     }
     else
     {
-        // Error case - emit errorOccurred signal
-        qDebug() << "AIService Error:" << reply->errorString();
-        emit errorOccurred(reply->errorString());
-        emit finished(QString("Error: %1").arg(reply->errorString()));
+        // Error case - only emit errorOccurred signal
+        qDebug() << "AIService Error:" << status.message;
+        emit errorOccurred(status.message);
     }
-    reply->deleteLater();
 }
+
 void AIService::ocr(const QString &imagePath)
 {
-    QUrl url(baseUrl + "/ocr");
-    QNetworkRequest request(url);
-
-    // Prepare multipart form
-    QHttpMultiPart *multiPart = new QHttpMultiPart(QHttpMultiPart::FormDataType);
-
-    QHttpPart imagePart;
-    imagePart.setHeader(QNetworkRequest::ContentDispositionHeader,
-                        QVariant("form-data; name=\"file\"; filename=\"" + QFileInfo(imagePath).fileName() + "\""));
-
-    QFile *file = new QFile(imagePath);
-    if (!file->open(QIODevice::ReadOnly)) {
+    QHttpMultiPart *multiPart = createImageUpload(imagePath);
+    if (!multiPart) {
         emit errorOccurred("Failed to open image: " + imagePath);
+        return;
+    }
+
+    // An upload cannot be replayed, so OCR only takes part in the circuit breaker, without retries
+    if (!AIResilience::instance().allowRequest(baseUrl)) {
         delete multiPart;
+        QTimer::singleShot(0, this, [this]() {
+            handleResult(QByteArray(), AIStatus::failure(AIStatusCode::CircuitOpen, "OCR service unavailable"),
+                         QByteArray());
+        });
         return;
     }
 
-    imagePart.setBodyDevice(file);
-    file->setParent(multiPart); // file will be deleted with multiPart
-    multiPart->append(imagePart);
+    auto started = std::make_shared<QElapsedTimer>();
+    started->start();
+    QNetworkRequest request(QUrl(baseUrl + "/ocr"));
+    AITransport::instance().post(request, multiPart, requestPriority, this,
+                                 [this, started, priority = requestPriority](QNetworkReply *reply, const QByteArray &body) {
+                                     AIStatus status = AIStatus::fromReply(reply);
+                                     recordOutcome(reply->request().url().path(), priority, status, started->elapsed());
+                                     PIPINO_TRACE_ELAPSED("ai", "AIService::ocr", started->nsecsElapsed());
+                                     handleResult(body, status, QByteArray());
+                                 });
+}
+
+AiResult<QString> AIService::ocrSync(const QString &imagePath, int timeoutMs)
+{
+    QHttpMultiPart *multiPart = createImageUpload(imagePath);
+    if (!multiPart) {
+        return AiResult<QString>::failure(AIStatusCode::ClientError, "Could not open file " + imagePath);
+    }
+    if (!AIResilience::instance().allowRequest(baseUrl)) {
+        delete multiPart;
+        return AiResult<QString>::failure(AIStatusCode::CircuitOpen, "OCR service unavailable");
+    }
 
-    QNetworkReply *reply = manager->post(request, multiPart);
-    multiPart->setParent(reply); // ensure cleanup
-    connect(reply, &QNetworkReply::finished, [=]() { handleReply(reply); });
+    QNetworkRequest request(QUrl(baseUrl + "/ocr"));
+    return waitForReply([&](AITransport::ReplyHandler handler) {
+        return AITransport::instance().post(request, multiPart, AIPriority::Interactive, this, handler);
+    }, AIPriority::Interactive, timeoutMs, "OCR service");
 }
 
-QString AIService::ocrSync(const QString &imagePath, int timeoutMs)
+QHttpMultiPart *AIService::createImageUpload(const QString &imagePath)
 {
-    QUrl url(baseUrl + "/ocr");
-    QNetworkRequest request(url);
+    QFile *file = new QFile(imagePath);
+    if (!file->open(QIODevice::ReadOnly)) {
+        delete file;
+        return nullptr;
+    }
 
+    // Prepare multipart form
     QHttpMultiPart *multiPart = new QHttpMultiPart(QHttpMultiPart::FormDataType);
 
     QHttpPart imagePart;
     imagePart.setHeader(QNetworkRequest::ContentDispositionHeader,
                         QVariant("form-data; name=\"file\"; filename=\"" + QFileInfo(imagePath).fileName() + "\""));
-
-    QFile *file = new QFile(imagePath);
-    if (!file->open(QIODevice::ReadOnly)) {
-        return "Error: Could not open file " + imagePath;
-    }
-
     imagePart.setBodyDevice(file);
-    file->setParent(multiPart);
+    file->setParent(multiPart); // file will be deleted with multiPart
     multiPart->append(imagePart);
-
-    QNetworkReply *reply = manager->post(request, multiPart);
-    multiPart->setParent(reply);
-
-    // Same blocking logic as your promptSync
-    QEventLoop loop;
-    QTimer timer;
-    timer.setSingleShot(true);
-
-    QString result;
-    bool finished = false;
-
-    connect(reply, &QNetworkReply::finished, [&]() {
-        if (reply->error() == QNetworkReply::NoError) {
-            result = QString(reply->readAll());
-        } else {
-            result = QString("Error: %1").arg(reply->errorString());
-        }
-        finished = true;
-        loop.quit();
-    });
-
-    connect(&timer, &QTimer::timeout, [&]() {
-        result = "Timeout: No response from OCR service within " + QString::number(timeoutMs) + "ms";
-        reply->abort();
-        finished = true;
-        loop.quit();
-    });
-
-    timer.start(timeoutMs);
-    if (!finished) {
-        loop.exec();
-    }
-
-    reply->deleteLater();
-    return result;
+    return multiPart;
 }
@@ -0,0 +1,380 @@
+#include "AITransport.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QSettings>
+#include <algorithm>
+
+namespace {
+constexpr int kDefaultMaxInFlightPerEndpoint = 4;
+
+// h2c with prior knowledge fails against HTTP/1.1-only servers, so cleartext HTTP/2
+// is opt-in; over TLS it is negotiated automatically
+const char *kHttp2CleartextSettingsKey = "ai/http2Cleartext";
+}
+
+AITransport& AITransport::instance()
+{
+    // Parented to the application so the manager is torn down while Qt is still alive
+    static AITransport *transport = new AITransport(QCoreApplication::instance());
+    return *transport;
+}
+
+AITransport::AITransport(QObject *parent)
+    : QObject(parent)
+    , manager(new QNetworkAccessManager(this))
+    , nextTicket(1)
+    , nextRequestId(1)
+    , maxInFlight(kDefaultMaxInFlightPerEndpoint)
+    , allowHttp2Cleartext(QSettings().value(kHttp2CleartextSettingsKey, false).toBool())
+{
+}
+
+quint64 AITransport::get(const QNetworkRequest& request, AIPriority priority, QObject *context,
+                         ReplyHandler handler, const QByteArray& coalesceKey)
+{
+    Pending pending;
+    pending.priority = priority;
+    pending.operation = Operation::Get;
+    pending.request = request;
+    pending.coalesceKey = coalesceKey;
+    return enqueue(std::move(pending), context, std::move(handler));
+}
+
+quint64 AITransport::post(const QNetworkRequest& request, const QByteArray& body, AIPriority priority,
+                          QObject *context, ReplyHandler handler, const QByteArray& coalesceKey)
+{
+    Pending pending;
+    pending.priority = priority;
+    pending.operation = Operation::Post;
+    pending.request = request;
+    pending.body = body;
+    pending.coalesceKey = coalesceKey;
+    return enqueue(std::move(pending), context, std::move(handler));
+}
+
+quint64 AITransport::post(const QNetworkRequest& request, QHttpMultiPart *multiPart, AIPriority priority,
+                          QObject *context, ReplyHandler handler)
+{
+    Pending pending;
+    pending.priority = priority;
+    pending.operation = Operation::PostMultiPart;
+    pending.request = request;
+    pending.multiPart = multiPart;
+    if (multiPart) {
+        multiPart->setParent(this); // Owned by the transport until it is handed to the reply
+    }
+    return enqueue(std::move(pending), context, std::move(handler));
+}
+
+quint64 AITransport::getStream(const QNetworkRequest& request, AIPriority priority, QObject *context,
+                               ReplyHandler handler, ReadyReadHandler readyReadHandler)
+{
+    Pending pending;
+    pending.priority = priority;
+    pending.operation = Operation::Get;
+    pending.request = request;
+    pending.readyReadHandler = std::move(readyReadHandler);
+    return enqueue(std::move(pending), context, std::move(handler));
+}
+
+quint64 AITransport::enqueue(Pending pending, QObject *context, ReplyHandler handler)
+{
+    Waiter waiter;
+    waiter.ticket = nextTicket++;
+    waiter.context = context;
+    waiter.hasContext = context != nullptr;
+    waiter.handler = std::move(handler);
+
+    if (!pending.coalesceKey.isEmpty() && joinInFlight(pending.coalesceKey, pending.priority, waiter)) {
+        return waiter.ticket;
+    }
+
+    pending.requestId = nextRequestId++;
+    pending.waiters.append(waiter);
+    pending.queuedFor.start();
+    preconnect(pending.request.url());
+
+    ticketRequests.insert(waiter.ticket, pending.requestId);
+    if (!pending.coalesceKey.isEmpty()) {
+        coalescing.insert(pending.coalesceKey, pending.requestId);
+    }
+
+    const QString endpoint = pending.request.url().path();
+    insertByPriority(queues[endpoint], std::move(pending));
+
+    dispatch(endpoint);
+    return waiter.ticket;
+}
+
+bool AITransport::joinInFlight(const QByteArray& coalesceKey, AIPriority priority, const Waiter& waiter)
+{
+    auto keyIt = coalescing.constFind(coalesceKey);
+    if (keyIt == coalescing.constEnd()) {
+        return false;
+    }
+    const quint64 requestId = keyIt.value();
+
+    auto activeIt = active.find(requestId);
+    if (activeIt != active.end()) {
+        activeIt->waiters.append(waiter);
+    } else {
+        QString endpoint;
+        int position = -1;
+        Pending *queued = findQueued(requestId, &endpoint, &position);
+        if (!queued) {
+            return false;
+        }
+        queued->waiters.append(waiter);
+
+        // An interactive caller must not wait behind the background prefetch it joined
+        if (int(priority) < int(queued->priority)) {
+            QList<Pending>& queue = queues[endpoint];
+            Pending promoted = queue.takeAt(position);
+            promoted.priority = priority;
+            insertByPriority(queue, std::move(promoted));
+        }
+    }
+
+    ticketRequests.insert(waiter.ticket, requestId);
+    ++counters.coalesced;
+    qDebug() << "AITransport: joined an identical in-flight request," << counters.coalesced << "upstream calls saved";
+    return true;
+}
+
+AITransport::Pending *AITransport::findQueued(quint64 requestId, QString *endpoint, int *position)
+{
+    for (auto queueIt = queues.begin(); queueIt != queues.end(); ++queueIt) {
+        QList<Pending>& queue = queueIt.value();
+        for (int i = 0; i < queue.size(); ++i) {
+            if (queue[i].requestId == requestId) {
+                if (endpoint) *endpoint = queueIt.key();
+                if (position) *position = i;
+                return &queue[i];
+            }
+        }
+    }
+    return nullptr;
+}
+
+void AITransport::insertByPriority(QList<Pending>& queue, Pending pending)
+{
+    // Stable insert: after every queued request of the same or higher priority
+    auto position = std::find_if(queue.begin(), queue.end(), [&](const Pending& queued) {
+        return int(queued.priority) > int(pending.priority);
+    });
+    queue.insert(position, std::move(pending));
+}
+
+void AITransport::dispatch(const QString& endpoint)
+{
+    auto it = queues.find(endpoint);
+    while (it != queues.end() && !it->isEmpty() && inFlightPerEndpoint.value(endpoint) < maxInFlight) {
+        Pending pending = it->takeFirst();
+        if (it->isEmpty()) {
+            queues.erase(it);
+        }
+        start(endpoint, std::move(pending));
+        it = queues.find(endpoint);
+    }
+}
+
+void AITransport::start(const QString& endpoint, Pending pending)
+{
+    qint64 waitedMs = pending.queuedFor.elapsed();
+    counters.totalQueueWaitMs += waitedMs;
+    counters.maxQueueWaitMs = qMax(counters.maxQueueWaitMs, waitedMs);
+    ++counters.dispatched;
+
+    QNetworkRequest request = prepareRequest(pending.request, pending.priority);
+    QNetworkReply *reply = nullptr;
+    switch (pending.operation) {
+    case Operation::Get:
+        reply = manager->get(request);
+        break;
+    case Operation::Post:
+        reply = manager->post(request, pending.body);
+        break;
+    case Operation::PostMultiPart:
+        reply = manager->post(request, pending.multiPart);
+        pending.multiPart->setParent(reply); // Freed together with the reply
+        break;
+    }
+
+    Active entry;
+    entry.endpoint = endpoint;
+    entry.reply = reply;
+    entry.coalesceKey = pending.coalesceKey;
+    entry.waiters = std::move(pending.waiters);
+    entry.readyReadHandler = std::move(pending.readyReadHandler);
+    const bool streaming = bool(entry.readyReadHandler);
+    active.insert(pending.requestId, std::move(entry));
+    ++inFlightPerEndpoint[endpoint];
+
+    const quint64 requestId = pending.requestId;
+    if (streaming) {
+        connect(reply, &QNetworkReply::readyRead, this, [this, requestId]() { onReplyReadyRead(requestId); });
+    }
+    connect(reply, &QNetworkReply::finished, this, [this, requestId]() { onReplyFinished(requestId); });
+}
+
+void AITransport::onReplyFinished(quint64 requestId)
+{
+    auto it = active.find(requestId);
+    if (it == active.end()) {
+        return;
+    }
+    Active entry = std::move(it.value());
+    active.erase(it);
+
+    if (!entry.coalesceKey.isEmpty()) {
+        coalescing.remove(entry.coalesceKey);
+    }
+    if (--inFlightPerEndpoint[entry.endpoint] <= 0) {
+        inFlightPerEndpoint.remove(entry.endpoint);
+    }
+    if (entry.reply->attribute(QNetworkRequest::Http2WasUsedAttribute).toBool()) {
+        ++counters.http2Replies;
+    }
+
+    // The slot is free before the handlers run, so a follow-up request they queue can start at once
+    dispatch(entry.endpoint);
+
+    // Read once: every coalesced caller gets the same body
+    const QByteArray body = entry.reply->readAll();
+    for (const Waiter& waiter : std::as_const(entry.waiters)) {
+        ticketRequests.remove(waiter.ticket);
+        bool contextAlive = !waiter.hasContext || !waiter.context.isNull();
+        if (waiter.handler && contextAlive) {
+            waiter.handler(entry.reply, body);
+        }
+    }
+    entry.reply->deleteLater();
+}
+
+void AITransport::onReplyReadyRead(quint64 requestId)
+{
+    auto it = active.find(requestId);
+    if (it == active.end() || !it->readyReadHandler || it->waiters.isEmpty()) {
+        return;
+    }
+    const Waiter& waiter = it->waiters.first();
+    if (waiter.hasContext && waiter.context.isNull()) {
+        return;
+    }
+    // Copy first: the handler may abort this very request
+    ReadyReadHandler readyReadHandler = it->readyReadHandler;
+    readyReadHandler(it->reply);
+}
+
+void AITransport::abort(quint64 ticket)
+{
+    auto ticketIt = ticketRequests.find(ticket);
+    if (ticketIt == ticketRequests.end()) {
+        return;
+    }
+    const quint64 requestId = ticketIt.value();
+    ticketRequests.erase(ticketIt);
+
+    auto dropWaiter = [ticket](QList<Waiter>& waiters) {
+        waiters.removeIf([ticket](const Waiter& waiter) { return waiter.ticket == ticket; });
+        return waiters.isEmpty();
+    };
+
+    auto activeIt = active.find(requestId);
+    if (activeIt != active.end()) {
+        if (dropWaiter(activeIt->waiters)) {
+            // Nobody is left waiting: finished() still fires and releases the slot
+            activeIt->readyReadHandler = nullptr;
+            activeIt->reply->abort();
+        }
+        return;
+    }
+
+    QString endpoint;
+    int position = -1;
+    Pending *queued = findQueued(requestId, &endpoint, &position);
+    if (queued && dropWaiter(queued->waiters)) {
+        if (!queued->coalesceKey.isEmpty()) {
+            coalescing.remove(queued->coalesceKey);
+        }
+        delete queued->multiPart;
+
+        QList<Pending>& queue = queues[endpoint];
+        queue.removeAt(position);
+        if (queue.isEmpty()) {
+            queues.remove(endpoint);
+        }
+    }
+}
+
+void AITransport::preconnect(const QUrl& url)
+{
+    QString host = url.host();
+    if (host.isEmpty()) {
+        return;
+    }
+
+    bool encrypted = url.scheme() == "https";
+    int port = url.port(encrypted ? 443 : 80);
+    QString hostKey = QString("%1://%2:%3").arg(url.scheme(), host).arg(port);
+    if (preconnectedHosts.contains(hostKey)) {
+        return;
+    }
+    preconnectedHosts.insert(hostKey);
+
+    // Connection setup then overlaps with whatever the caller does before its first request
+    if (encrypted) {
+        manager->connectToHostEncrypted(host, quint16(port));
+    } else {
+        manager->connectToHost(host, quint16(port));
+    }
+}
+
+void AITransport::setMaxInFlightPerEndpoint(int count)
+{
+    maxInFlight = qMax(1, count);
+    const QStringList endpoints = queues.keys();
+    for (const QString& endpoint : endpoints) {
+        dispatch(endpoint);
+    }
+}
+
+int AITransport::maxInFlightPerEndpoint() const
+{
+    return maxInFlight;
+}
+
+AITransport::Stats AITransport::stats() const
+{
+    Stats snapshot = counters;
+    snapshot.inFlight = active.size();
+    snapshot.queued = 0;
+    for (const QList<Pending>& queue : queues) {
+        snapshot.queued += queue.size();
+    }
+    return snapshot;
+}
+
+QNetworkRequest AITransport::prepareRequest(QNetworkRequest request, AIPriority priority) const
+{
+    request.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+#if QT_VERSION >= QT_VERSION_CHECK(6, 3, 0)
+    if (allowHttp2Cleartext) {
+        request.setAttribute(QNetworkRequest::Http2CleartextAllowedAttribute, true);
+    }
+#endif
+
+    // Also orders requests inside QNetworkAccessManager's own per-host connection queue
+    switch (priority) {
+    case AIPriority::Interactive:
+        request.setPriority(QNetworkRequest::HighPriority);
+        break;
+    case AIPriority::Normal:
+        request.setPriority(QNetworkRequest::NormalPriority);
+        break;
+    case AIPriority::Background:
+        request.setPriority(QNetworkRequest::LowPriority);
+        break;
+    }
+    return request;
+}
@@ -0,0 +1,64 @@
+#include "AiResult.h"
+#include <QNetworkReply>
+
+bool AIStatus::isRetryable() const
+{
+    return code == AIStatusCode::Timeout || code == AIStatusCode::NetworkError ||
+           code == AIStatusCode::ServerError;
+}
+
+bool AIStatus::isBackendFailure() const
+{
+    return isRetryable();
+}
+
+QString AIStatus::toErrorString() const
+{
+    switch (code) {
+    case AIStatusCode::Ok:
+        return QString();
+    case AIStatusCode::Timeout:
+        return "Timeout: " + message;
+    default:
+        return "Error: " + message;
+    }
+}
+
+AIStatus AIStatus::withError(AIStatusCode errorCode, const QString &errorMessage) const
+{
+    AIStatus status = *this;
+    status.code = errorCode;
+    status.message = errorMessage;
+    return status;
+}
+
+AIStatus AIStatus::failure(AIStatusCode code, const QString &message)
+{
+    AIStatus status;
+    status.code = code;
+    status.message = message;
+    return status;
+}
+
+AIStatus AIStatus::fromReply(QNetworkReply *reply)
+{
+    AIStatus status;
+    status.httpStatus = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (reply->error() == QNetworkReply::NoError) {
+        return status;
+    }
+
+    status.message = reply->errorString();
+    if (status.httpStatus >= 500 || status.httpStatus == 429) {
+        status.code = AIStatusCode::ServerError;
+    } else if (status.httpStatus >= 400) {
+        status.code = AIStatusCode::ClientError;
+    } else if (reply->error() == QNetworkReply::TimeoutError ||
+               reply->error() == QNetworkReply::OperationCanceledError) {
+        // Aborted requests never reach a handler, so a cancelled reply is the transfer timeout firing
+        status.code = AIStatusCode::Timeout;
+    } else {
+        status.code = AIStatusCode::NetworkError;
+    }
+    return status;
+}
@@ -2,7 +2,9 @@
 #include "Model.h"
 #include "View.h"
 #include "ProblemGenerator.h"
-#include <QDateTime>
+#include "ProblemPool.h"
+#include "EventLog.h"
+#include "Trace.h"
 #include <QMessageBox>
 #include <QApplication>
 
@@ -11,11 +13,19 @@ Controller::Controller(QObject *parent)
     , model(nullptr)
     , view(nullptr)
     , problemGenerator(nullptr)
+    , problemPool(nullptr)
     , currentUnitIndex(-1)
     , currentProblemIndex(-1)
+    , currentProblemId(0)
+    , waitingForPool(false)
 {
     // Initialize ProblemGenerator
     problemGenerator = new ProblemGenerator(this);
+    
+    // Keep a few problems per topic/difficulty ready so selections rarely wait on the AI
+    problemPool = new ProblemPool(problemGenerator, this);
+    connect(problemPool, &ProblemPool::problemReady, this, &Controller::onPoolProblemReady);
+    connect(problemPool, &ProblemPool::generationFailed, this, &Controller::onPoolGenerationFailed);
 }
 
 void Controller::setModel(Model* mdl)
@@ -26,6 +36,11 @@ void Controller::setModel(Model* mdl)
     if (problemGenerator && model) {
         problemGenerator->setModel(model);
     }
+    
+    // Start prefetching for the model's curriculum at the user's difficulty
+    if (problemPool && model) {
+        problemPool->setModel(model);
+    }
 }
 
 void Controller::setView(View* vw)
@@ -42,96 +57,149 @@ void Controller::initializeApplication()
         view->setModel(model);
         view->setController(this);
         qDebug() << "Application initialized with" << model->getUnitCount() << "units";
-        logUserAction("Application Started", QString("Units available: %1").arg(model->getUnitCount()));
+        
+        UserEvent event(UserEvent::Type::AppStarted);
+        event.count = model->getUnitCount();
+        event.difficulty = int(model->userDifficulty());
+        EventLog::instance().record(std::move(event));
     }
 }
 
 void Controller::handleProblemSelection(int unitIndex, int problemIndex)
 {
+    PIPINO_TRACE_SCOPE("controller", "Controller::handleProblemSelection");
     if (!model) return;
     
+    // A new selection supersedes the one still waiting; its generation keeps filling the pool
+    waitingForPool = false;
+    
     currentUnitIndex = unitIndex;
     currentProblemIndex = problemIndex;
     
     // Update the Model's current selection so getCurrentProblem() and getCurrentDifficulty() work
     model->setCurrentSelection(unitIndex, problemIndex);
+    currentProblemId = model->problemId(unitIndex, problemIndex);
+    selectionTimer.start();
+    problemShownTimer.invalidate();
     
     const Unit* unit = model->getUnit(unitIndex);
     if (unit && problemIndex >= 0 && problemIndex < unit->problems.size()) {
         const Problem& problem = unit->problems[problemIndex];
         
-        QString logDetails = QString("Unit: %1, Problem: %2, Difficulty: %3")
-                           .arg(unit->name, problem.name, model->getUserDifficulty());
+        EventLog::instance().record(contextEvent(UserEvent::Type::ProblemSelected));
         
-        if (problemIndex < 3) {
-            // First 3 problems use MultipleChoiceWindow - Generate AI problem without popups
-            logUserAction("Multiple Choice Problem Selected", logDetails);
-            qDebug() << "Opening Multiple Choice for:" << problem.name;
+        // First 3 problems use MultipleChoiceWindow, problems 4+ use ScanWindow
+        bool multipleChoice = problemIndex < 3;
+        
+        if (problemGenerator) {
+            ProblemPoolKey poolKey = ProblemPool::keyFor(problem.topic, model->userDifficulty(), problemIndex);
             
-            if (problemGenerator) {
-                qDebug() << "🤖 Generating AI problem for:" << problem.name;
-                qDebug() << "   Topic:" << problem.name;
-                qDebug() << "   Difficulty:" << model->getUserDifficulty();
-                
-                // Generate the problem synchronously (no UI popups)
-                GeneratedProblem generatedProblem = problemGenerator->generateCompleteProblemSync(
-                    problem.name, 
-                    model->getUserDifficulty(),
-                    true
-                );
-                
-                // Update the model only if valid MC content exists
-                if (generatedProblem.isMultipleChoice && !generatedProblem.choices.isEmpty()) {
-                    model->updateProblemContent(unitIndex, problemIndex, 
-                                               generatedProblem.problemStatement,
-                                               generatedProblem.choices);
-                    // Ask the view to refresh the visible content if it's open
-                    if (view) {
-                        view->refreshMultipleChoice(unitIndex, problemIndex);
-                    }
+            // After a restart, show the content restored from the snapshot first; the pool
+            // only refills in the background so the next selection gets a fresh problem
+            bool restoredUsable = multipleChoice ? !problem.choices.isEmpty() : !problem.problemStatement.isEmpty();
+            if (model->takeRestoredContent(problem.id) && restoredUsable) {
+                recordProblemShown(problem.id);
+                if (problemPool) {
+                    problemPool->prefetch(poolKey);
                 }
+                return;
             }
-        } else {
-            // Problems 4+ use ScanWindow - Generate non-MC problem statement
-            logUserAction("Scan Problem Selected", logDetails);
-            qDebug() << "Opening Scan Window for:" << problem.name;
             
-            if (problemGenerator) {
-                qDebug() << "🤖 Generating AI problem (non-MC) for:" << problem.name;
-                qDebug() << "   Topic:" << problem.name;
-                qDebug() << "   Difficulty:" << model->getUserDifficulty();
-                
-                // Generate problem without forcing multiple choice
-                GeneratedProblem generatedProblem = problemGenerator->generateCompleteProblemSync(
-                    problem.name, 
-                    model->getUserDifficulty(),
-                    false  // Don't force multiple choice for scan problems
-                );
-                
-                // Update the model with the generated problem statement
-                if (!generatedProblem.problemStatement.isEmpty() && 
-                    !generatedProblem.problemStatement.startsWith("Error:") &&
-                    !generatedProblem.problemStatement.startsWith("Timeout:")) {
-                    // Create empty choices for scan problems
-                    QVector<MultipleChoiceOption> emptyChoices;
-                    model->updateProblemContent(unitIndex, problemIndex, 
-                                               generatedProblem.problemStatement,
-                                               emptyChoices);
-                    qDebug() << "✅ Generated scan problem successfully";
-                } else {
-                    qDebug() << "⚠️ Failed to generate scan problem:" << generatedProblem.problemStatement;
-                }
+            // Serve straight from the prefetched pool when possible
+            GeneratedProblem pooledProblem;
+            if (problemPool && problemPool->take(poolKey, pooledProblem)) {
+                applyGeneratedProblem(problem.id, multipleChoice, AiResult<GeneratedProblem>::success(pooledProblem));
+                return;
+            }
+            
+            // Clear the old content so the dialog opens in its "generating" state; not saved
+            model->updateProblemContent(problem.id, QString(), QVector<MultipleChoiceOption>(), false);
+            
+            // The dialog is shown right away; the pool generates the problem (or lets the
+            // prefetch already running for it finish) and reports back
+            waitingForPool = true;
+            pendingPoolKey = poolKey;
+            if (problemPool) {
+                problemPool->request(poolKey);
             }
         }
     }
 }
 
+void Controller::onPoolProblemReady(const ProblemPoolKey& key)
+{
+    if (!waitingForPool || !(key == pendingPoolKey) || !problemPool) return;
+    
+    GeneratedProblem pooledProblem;
+    if (problemPool->take(key, pooledProblem)) {
+        waitingForPool = false;
+        applyGeneratedProblem(currentProblemId, key.multipleChoice, AiResult<GeneratedProblem>::success(pooledProblem));
+    }
+}
+
+void Controller::onPoolGenerationFailed(const ProblemPoolKey& key, const AIStatus& status)
+{
+    if (!waitingForPool || !(key == pendingPoolKey)) return;
+    
+    waitingForPool = false;
+    applyGeneratedProblem(currentProblemId, key.multipleChoice, AiResult<GeneratedProblem>::failure(status));
+}
+
+void Controller::applyGeneratedProblem(ProblemId problemId, bool multipleChoice,
+                                       const AiResult<GeneratedProblem>& result)
+{
+    PIPINO_TRACE_SCOPE("controller", "Controller::applyGeneratedProblem");
+    if (!model) return;
+    
+    bool failed = !result.ok();
+    const GeneratedProblem& generatedProblem = result.value();
+    
+    if (multipleChoice) {
+        // Update the model only if valid MC content exists
+        if (!failed && generatedProblem.isMultipleChoice && !generatedProblem.choices.isEmpty()) {
+            model->updateProblemContent(problemId,
+                                       generatedProblem.problemStatement,
+                                       generatedProblem.choices);
+            recordProblemShown(problemId);
+            return;
+        }
+    } else if (!failed) {
+        // Create empty choices for scan problems
+        QVector<MultipleChoiceOption> emptyChoices;
+        model->updateProblemContent(problemId,
+                                   generatedProblem.problemStatement,
+                                   emptyChoices);
+        recordProblemShown(problemId);
+        return;
+    }
+    
+    qDebug() << "⚠️ Failed to generate problem:"
+             << (failed ? result.errorMessage() : QString("no multiple choice options in the answer"));
+    model->updateProblemContent(problemId,
+                               "Could not generate a problem right now. Please go back and try again.",
+                               QVector<MultipleChoiceOption>(), false);
+}
+
+void Controller::recordProblemShown(ProblemId problemId)
+{
+    if (problemId != currentProblemId) return;
+    
+    // Answer latency is measured from here, once there is something to answer
+    UserEvent event = contextEvent(UserEvent::Type::ProblemShown);
+    event.latencyMs = selectionTimer.isValid() ? selectionTimer.elapsed() : -1;
+    EventLog::instance().record(std::move(event));
+    problemShownTimer.start();
+}
+
 void Controller::addNewUnit(const QString& name, const QString& description)
 {
     if (model) {
         Unit newUnit(name, description);
         model->addUnit(newUnit);
-        logUserAction("Unit Added", QString("Name: %1").arg(name));
+        UserEvent event(UserEvent::Type::UnitAdded);
+        event.unitIndex = model->getUnitCount() - 1;
+        event.name = name;
+        EventLog::instance().record(std::move(event));
         qDebug() << "Added new unit:" << name;
     }
 }
@@ -140,9 +208,13 @@ void Controller::addProblemToUnit(int unitIndex, const QString& problemName,
                                  const QString& description, const QString& difficulty)
 {
     if (model) {
-        Problem newProblem(problemName, description, difficulty);
+        Problem newProblem(problemName, description, difficultyFromString(difficulty, Difficulty::Easy));
         model->addProblemToUnit(unitIndex, newProblem);
-        logUserAction("Problem Added", QString("Unit %1, Problem: %2").arg(unitIndex).arg(problemName));
+        UserEvent event(UserEvent::Type::ProblemAdded);
+        event.unitIndex = unitIndex;
+        event.difficulty = int(newProblem.difficulty);
+        event.name = problemName;
+        EventLog::instance().record(std::move(event));
         qDebug() << "Added problem" << problemName << "to unit" << unitIndex;
     }
 }
@@ -154,23 +226,19 @@ void Controller::onProblemSelected(int unitIndex, int problemIndex)
 
 void Controller::onBackButtonClicked()
 {
-    logUserAction("Back Button Clicked", QString("From Unit %1, Problem %2").arg(currentUnitIndex).arg(currentProblemIndex));
-    qDebug() << "Back button clicked - returning to previous window";
+    EventLog::instance().record(contextEvent(UserEvent::Type::BackNavigated));
 }
 
 void Controller::onSettingsButtonClicked()
 {
-    logUserAction("Settings Opened", QString("From Unit %1, Problem %2").arg(currentUnitIndex).arg(currentProblemIndex));
-    qDebug() << "Settings button clicked - opening settings window";
+    EventLog::instance().record(contextEvent(UserEvent::Type::SettingsOpened));
 }
 
 void Controller::onScanButtonClicked()
 {
-    logUserAction("Scan Button Clicked", QString("Unit %1, Problem %2").arg(currentUnitIndex).arg(currentProblemIndex));
-    qDebug() << "Scan button clicked - would open camera interface";
+    EventLog::instance().record(contextEvent(UserEvent::Type::ScanRequested));
     
     // Here you would integrate with camera/scanning functionality
-    // For now, just log the action
 }
 
 void Controller::onTheoryButtonClicked()
@@ -178,9 +246,7 @@ void Controller::onTheoryButtonClicked()
     if (model && currentUnitIndex >= 0 && currentProblemIndex >= 0) {
         const Unit* unit = model->getUnit(currentUnitIndex);
         if (unit && currentProblemIndex < unit->problems.size()) {
-            const Problem& problem = unit->problems[currentProblemIndex];
-            logUserAction("Theory Opened", QString("Unit: %1, Problem: %2").arg(unit->name, problem.name));
-            qDebug() << "Theory button clicked for:" << problem.name;
+            EventLog::instance().record(contextEvent(UserEvent::Type::TheoryOpened));
         }
     }
 }
@@ -191,17 +257,12 @@ void Controller::onChoiceSelected(int choiceIndex)
         int correctIndex = model->getCorrectChoiceIndex(currentUnitIndex, currentProblemIndex);
         bool isCorrect = (choiceIndex == correctIndex);
         
-        QString result = isCorrect ? "Correct" : "Incorrect";
-        QString logDetails = QString("Choice: %1, Correct: %2, Result: %3")
-                           .arg(choiceIndex).arg(correctIndex).arg(result);
-        
-        logUserAction("Answer Selected", logDetails);
-        
-        if (isCorrect) {
-            qDebug() << "🎉 Correct answer selected! Choice:" << choiceIndex;
-        } else {
-            qDebug() << "❌ Incorrect answer. Selected:" << choiceIndex << "Correct:" << correctIndex;
-        }
+        UserEvent event = contextEvent(UserEvent::Type::AnswerSelected);
+        event.choice = choiceIndex;
+        event.correctChoice = correctIndex;
+        event.correct = isCorrect ? 1 : 0;
+        event.latencyMs = problemShownTimer.isValid() ? problemShownTimer.elapsed() : -1;
+        EventLog::instance().record(std::move(event));
         
         // Here you could add scoring, progress tracking, etc.
     }
@@ -219,16 +280,14 @@ void Controller::connectSignals()
     }
 }
 
-void Controller::logUserAction(const QString& action, const QString& details)
+UserEvent Controller::contextEvent(UserEvent::Type type) const
 {
-    QString timestamp = QDateTime::currentDateTime().toString("hh:mm:ss");
-    QString logMessage = QString("[%1] %2").arg(timestamp, action);
-    
-    if (!details.isEmpty()) {
-        logMessage += QString(" - %1").arg(details);
+    UserEvent event(type);
+    event.unitIndex = currentUnitIndex;
+    event.problemIndex = currentProblemIndex;
+    event.problemId = currentProblemId;
+    if (model) {
+        event.difficulty = int(model->userDifficulty());
     }
-    
-    qDebug() << logMessage;
-    
-    // Here you could also log to a file, send to analytics, etc.
+    return event;
 }
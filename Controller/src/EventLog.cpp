@@ -0,0 +1,188 @@
+#include "EventLog.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStandardPaths>
+#include <chrono>
+
+namespace {
+constexpr qint64 kDefaultMaxFileBytes = 4LL * 1024 * 1024;  // Per file, before rotating
+constexpr int kDefaultKeepFiles = 4;                         // Rotated files kept besides the live one
+constexpr int kWriteIntervalMs = 2000;                       // How long events may wait for their batch
+
+const char* typeName(UserEvent::Type type)
+{
+    switch (type) {
+    case UserEvent::Type::AppStarted:      return "app_started";
+    case UserEvent::Type::ProblemSelected: return "problem_selected";
+    case UserEvent::Type::ProblemShown:    return "problem_shown";
+    case UserEvent::Type::AnswerSelected:  return "answer";
+    case UserEvent::Type::ScanRequested:   return "scan";
+    case UserEvent::Type::TheoryOpened:    return "theory";
+    case UserEvent::Type::SettingsOpened:  return "settings";
+    case UserEvent::Type::BackNavigated:   return "back";
+    case UserEvent::Type::UnitAdded:       return "unit_added";
+    case UserEvent::Type::ProblemAdded:    return "problem_added";
+    }
+    return "unknown";
+}
+}
+
+EventLog& EventLog::instance()
+{
+    static EventLog log([] {
+        QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+        QDir().mkpath(dir);
+        return dir + "/events.ndjson";
+    }());
+    return log;
+}
+
+EventLog::EventLog(const QString& path)
+    : filePath(path)
+    , file(path)
+    , maxFileBytes(kDefaultMaxFileBytes)
+    , keepFiles(kDefaultKeepFiles)
+{
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "EventLog: cannot open" << filePath << "- events will be dropped";
+    }
+    writer = std::thread([this]() { run(); });
+}
+
+EventLog::~EventLog()
+{
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    writer.join();
+
+    // Whatever was recorded after the writer's last pass
+    drain();
+}
+
+void EventLog::record(UserEvent event)
+{
+    event.timestampMs = QDateTime::currentMSecsSinceEpoch();
+    Node* node = new Node{std::move(event), pending.load(std::memory_order_relaxed)};
+    while (!pending.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed)) {
+    }
+    recordedCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void EventLog::flush()
+{
+    drain();
+}
+
+void EventLog::setRotation(qint64 maxBytes, int keep)
+{
+    maxFileBytes.store(qMax<qint64>(1024, maxBytes), std::memory_order_relaxed);
+    keepFiles.store(qMax(0, keep), std::memory_order_relaxed);
+}
+
+EventLog::Stats EventLog::stats() const
+{
+    Stats stats;
+    stats.recorded = recordedCount.load(std::memory_order_relaxed);
+    stats.written = writtenCount.load(std::memory_order_relaxed);
+    stats.batches = batchCount.load(std::memory_order_relaxed);
+    stats.rotations = rotationCount.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void EventLog::run()
+{
+    std::unique_lock<std::mutex> lock(wakeMutex);
+    while (!stopping) {
+        wake.wait_for(lock, std::chrono::milliseconds(kWriteIntervalMs), [this]() { return stopping; });
+        lock.unlock();
+        drain();
+        lock.lock();
+    }
+}
+
+void EventLog::drain()
+{
+    std::lock_guard<std::mutex> lock(fileMutex);
+
+    // Take the whole list in one step; it is newest first, so reverse it into recording order
+    Node* node = pending.exchange(nullptr, std::memory_order_acquire);
+    if (!node) {
+        return;
+    }
+    Node* ordered = nullptr;
+    while (node) {
+        Node* next = node->next;
+        node->next = ordered;
+        ordered = node;
+        node = next;
+    }
+
+    QByteArray batch;
+    quint64 count = 0;
+    while (ordered) {
+        Node* next = ordered->next;
+        batch += toJsonLine(ordered->event);
+        delete ordered;
+        ordered = next;
+        ++count;
+    }
+
+    if (file.isOpen()) {
+        file.write(batch);
+        file.flush();
+        writtenCount.fetch_add(count, std::memory_order_relaxed);
+        batchCount.fetch_add(1, std::memory_order_relaxed);
+        if (file.size() >= maxFileBytes.load(std::memory_order_relaxed)) {
+            rotate();
+        }
+    }
+}
+
+void EventLog::rotate()
+{
+    // events.ndjson -> events.ndjson.1 -> .2 ...; the oldest falls off the end
+    file.close();
+    const int keep = keepFiles.load(std::memory_order_relaxed);
+    if (keep == 0) {
+        QFile::remove(filePath);
+    } else {
+        QFile::remove(filePath + "." + QString::number(keep));
+        for (int i = keep - 1; i >= 1; --i) {
+            QFile::rename(filePath + "." + QString::number(i), filePath + "." + QString::number(i + 1));
+        }
+        QFile::rename(filePath, filePath + ".1");
+    }
+    rotationCount.fetch_add(1, std::memory_order_relaxed);
+
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "EventLog: cannot reopen" << filePath << "after rotation - events will be dropped";
+    }
+}
+
+QByteArray EventLog::toJsonLine(const UserEvent& event)
+{
+    QJsonObject json{
+        {"t", double(event.timestampMs)},
+        {"type", typeName(event.type)}
+    };
+    if (event.problemId != 0) json.insert("problemId", double(event.problemId));
+    if (event.unitIndex >= 0) json.insert("unit", event.unitIndex);
+    if (event.problemIndex >= 0) json.insert("problem", event.problemIndex);
+    if (event.difficulty >= 0 && event.difficulty < kDifficultyCount) {
+        json.insert("difficulty", difficultyName(Difficulty(event.difficulty)));
+    }
+    if (event.choice >= 0) json.insert("choice", event.choice);
+    if (event.correctChoice >= 0) json.insert("correctChoice", event.correctChoice);
+    if (event.correct >= 0) json.insert("correct", event.correct == 1);
+    if (event.latencyMs >= 0) json.insert("latencyMs", double(event.latencyMs));
+    if (event.count >= 0) json.insert("count", event.count);
+    if (!event.name.isEmpty()) json.insert("name", event.name);
+
+    return QJsonDocument(json).toJson(QJsonDocument::Compact) + '\n';
+}
@@ -1,14 +1,101 @@
 #include "ProblemGenerator.h"
+#include "ResponseParser.h"
+#include "Trace.h"
 #include <QDebug>
 #include <QJsonDocument>
 #include <QJsonObject>
 
+namespace {
+// Prompt text per difficulty, indexed by Difficulty; choosing a prompt is a table lookup
+struct DifficultyPrompts {
+    const char *single;          // createPrompt, %1 = topic
+    const char *multipleChoice;  // createMultipleChoicePrompt, %1 = topic
+    const char *batchLevel;      // createBatchPrompt requirement line
+};
+
+const DifficultyPrompts kDifficultyPrompts[kDifficultyCount] = {
+    {
+        // Easy
+        "Generate a simple %1 problem suitable for beginners. With no words, just the problem statement."
+        "Requirements:\n"
+        "- Use basic concepts and simple numbers\n"
+        "- The problem should be solvable in 1-2 steps\n"
+        "- Provide only the problem statement, no solution\n"
+        "- Example format: 'Calculate: 15 + 8 - 3'\n\n"
+        "Topic: %1\n"
+        "Difficulty: Easy",
+        "Generate a simple %1 multiple choice problem suitable for beginners. "
+        "Requirements:\n"
+        "- Create a clear, easy-to-understand problem statement\n"
+        "- Use basic concepts and simple numbers\n"
+        "- The problem should be solvable in 1-2 steps\n"
+        "- Provide exactly 4 multiple choice options (A, B, C, D)\n"
+        "- Only ONE option should be correct\n"
+        "- Make the incorrect options plausible but clearly wrong\n",
+        "- Suitable for beginners: basic concepts, simple numbers, solvable in 1-2 steps\n"
+    },
+    {
+        // Medium
+        "Generate a %1 problem of moderate difficulty. "
+        "Requirements:\n"
+        "- Use intermediate-level concepts and reasonable numbers\n"
+        "- Include some context or real-world application if appropriate\n"
+        "- The problem should challenge but not overwhelm\n"
+        "- Provide only the problem statement, no solution\n"
+        "- Make it educational and practical\n"
+        "- Example format: 'A rectangle has length 12 cm and width 8 cm. Find its area and perimeter.'\n\n"
+        "Topic: %1\n"
+        "Difficulty: Medium",
+        "Generate a %1 multiple choice problem of moderate difficulty. "
+        "Requirements:\n"
+        "- Create a problem that requires multiple steps to solve\n"
+        "- Use intermediate-level concepts and reasonable numbers\n"
+        "- Include some context or real-world application if appropriate\n"
+        "- Provide exactly 4 multiple choice options (A, B, C, D)\n"
+        "- Only ONE option should be correct\n"
+        "- Make the incorrect options result from common mistakes\n",
+        "- Moderate difficulty: multiple steps, intermediate concepts, some real-world context where appropriate\n"
+    },
+    {
+        // Hard
+        "Generate a challenging %1 problem for advanced students. "
+        "Requirements:\n"
+        "- Create a complex, multi-step problem\n"
+        "- Use advanced concepts and realistic scenarios\n"
+        "- Include detailed context and real-world applications\n"
+        "- The problem should require deep understanding and multiple solution steps\n"
+        "- Provide only the problem statement, no solution\n"
+        "- Make it intellectually stimulating and comprehensive\n"
+        "- Example format: 'A projectile is launched at 45° with initial velocity 25 m/s from a 10m high platform. Calculate the maximum height, time of flight, and horizontal range.'\n\n"
+        "Topic: %1\n"
+        "Difficulty: Hard",
+        "Generate a challenging %1 multiple choice problem. "
+        "Requirements:\n"
+        "- Create a complex, multi-step problem\n"
+        "- Use advanced concepts and realistic scenarios\n"
+        "- Provide exactly 4 multiple choice options (A, B, C, D)\n"
+        "- Only ONE option should be correct\n"
+        "- Make the incorrect options sophisticated and challenging\n",
+        "- Challenging: complex multi-step problems with advanced concepts and realistic scenarios\n"
+    }
+};
+
+const DifficultyPrompts& promptsFor(Difficulty difficulty)
+{
+    return kDifficultyPrompts[int(difficulty)];
+}
+}
+
 ProblemGenerator::ProblemGenerator(QObject *parent)
     : QObject(parent), aiService(nullptr), model(nullptr)
 {
     // Initialize AI service
     aiService = new AIService(this);
     
+    // Identical prompts should still produce fresh problems, so skip cached answers
+    // (responses are still stored and used as an offline fallback)
+    aiService->setCacheBypass(true);
+    
     // Connect AI service signals
     connect(aiService, &AIService::finished, this, &ProblemGenerator::handleAIResponse);
     connect(aiService, &AIService::errorOccurred, this, &ProblemGenerator::handleAIError);
@@ -28,14 +115,13 @@ void ProblemGenerator::generateProblem()
     
     // Get current problem and difficulty from model
     std::string currentProblem = model->getCurrentProblem();
-    std::string currentDifficulty = model->getCurrentDifficulty();
     
     // Convert to QString for easier handling
     QString problemType = QString::fromStdString(currentProblem);
-    QString difficulty = QString::fromStdString(currentDifficulty);
+    Difficulty difficulty = model->userDifficulty();
     
     // Check if we have valid data
-    if (problemType == "No problem selected" || difficulty == "No difficulty selected") {
+    if (problemType == "No problem selected") {
         emit errorOccurred("No problem or difficulty selected. Please select a problem first.");
         return;
     }
@@ -43,7 +129,7 @@ void ProblemGenerator::generateProblem()
     generateProblem(problemType, difficulty);
 }
 
-void ProblemGenerator::generateProblem(const QString& problemType, const QString& difficulty)
+void ProblemGenerator::generateProblem(const QString& problemType, Difficulty difficulty)
 {
     if (!aiService) {
         emit errorOccurred("AI Service not initialized.");
@@ -53,72 +139,20 @@ void ProblemGenerator::generateProblem(const QString& problemType, const QString
     // Create appropriate prompt
     QString prompt = createPrompt(problemType, difficulty);
     
-    qDebug() << "Generating problem for:" << problemType << "at" << difficulty << "difficulty";
+    qDebug() << "Generating problem for:" << problemType << "at" << difficultyName(difficulty) << "difficulty";
     // qDebug() << "Prompt:" << prompt;
     
     // Send prompt to AI service
     aiService->prompt(prompt);
 }
 
-QString ProblemGenerator::createPrompt(const QString& problemType, const QString& difficulty)
+QString ProblemGenerator::createPrompt(const QString& problemType, Difficulty difficulty)
 {
-    QString difficultyLower = difficulty.toLower();
-    
-    QString prompt;
+    PIPINO_TRACE_SCOPE("generator", "ProblemGenerator::createPrompt");
+    QString prompt = QString(promptsFor(difficulty).single).arg(problemType);
     
-    if (difficultyLower == "easy") {
-        prompt = QString(
-            "Generate a simple %1 problem suitable for beginners. With no words, just the problem statement."
-            "Requirements:\n"
-            "- Use basic concepts and simple numbers\n"
-            "- The problem should be solvable in 1-2 steps\n"
-            "- Provide only the problem statement, no solution\n"
-            "- Example format: 'Calculate: 15 + 8 - 3'\n\n"
-            "Topic: %1\n"
-            "Difficulty: Easy"
-        ).arg(problemType);
-    }
-    else if (difficultyLower == "medium") {
-        prompt = QString(
-            "Generate a %1 problem of moderate difficulty. "
-            "Requirements:\n"
-            "- Use intermediate-level concepts and reasonable numbers\n"
-            "- Include some context or real-world application if appropriate\n"
-            "- The problem should challenge but not overwhelm\n"
-            "- Provide only the problem statement, no solution\n"
-            "- Make it educational and practical\n"
-            "- Example format: 'A rectangle has length 12 cm and width 8 cm. Find its area and perimeter.'\n\n"
-            "Topic: %1\n"
-            "Difficulty: Medium"
-        ).arg(problemType);
-    }
-    else if (difficultyLower == "hard") {
-        prompt = QString(
-            "Generate a challenging %1 problem for advanced students. "
-            "Requirements:\n"
-            "- Create a complex, multi-step problem\n"
-            "- Use advanced concepts and realistic scenarios\n"
-            "- Include detailed context and real-world applications\n"
-            "- The problem should require deep understanding and multiple solution steps\n"
-            "- Provide only the problem statement, no solution\n"
-            "- Make it intellectually stimulating and comprehensive\n"
-            "- Example format: 'A projectile is launched at 45° with initial velocity 25 m/s from a 10m high platform. Calculate the maximum height, time of flight, and horizontal range.'\n\n"
-            "Topic: %1\n"
-            "Difficulty: Hard"
-        ).arg(problemType);
-    }
-    else {
-        // Default to medium if difficulty is not recognized
-        prompt = QString(
-            "Generate a %1 problem. "
-            "Requirements:\n"
-            "- Create a clear problem statement\n"
-            "- Use appropriate mathematical concepts\n"
-            "- Provide only the problem statement, no solution\n"
-            "- Make it educational and engaging\n\n"
-            "Topic: %1"
-        ).arg(problemType);
-    }
+    // Ask for the versioned JSON contract; see ResponseParser
+    prompt += ResponseParser::problemFormatInstructions(1, false);
     
     return prompt;
 }
@@ -146,245 +180,278 @@ void ProblemGenerator::handleAIError(const QString& error)
 
 QString ProblemGenerator::extractProblemFromResponse(const QString& response)
 {
-    // Try to parse as JSON first
-    QJsonParseError parseError;
-    QJsonDocument doc = QJsonDocument::fromJson(response.toUtf8(), &parseError);
-    
-    QString content;
-    if (parseError.error == QJsonParseError::NoError && doc.isObject()) {
-        QJsonObject obj = doc.object();
-        
-        // Try different possible keys for the response content
-        if (obj.contains("content")) {
-            content = obj["content"].toString();
-        } else if (obj.contains("response")) {
-            content = obj["response"].toString();
-        } else if (obj.contains("message")) {
-            content = obj["message"].toString();
-        } else if (obj.contains("text")) {
-            content = obj["text"].toString();
-        } else if (obj.contains("problem")) {
-            content = obj["problem"].toString();
-        } else {
-            // If no recognized key, use the whole response
-            content = response;
-        }
-    } else {
-        // If not JSON, use the response as-is
-        content = response;
-    }
-    
-    // Clean up the content
-    content = content.trimmed();
-    
-    // Remove common prefixes that might be added by the LLM
-    QStringList prefixesToRemove = {
-        "Problem:",
-        "Problem Statement:",
-        "Here's a problem:",
-        "Here is a problem:",
-        "Generated problem:",
-        "Math problem:"
-    };
-    
-    for (const QString& prefix : prefixesToRemove) {
-        if (content.startsWith(prefix, Qt::CaseInsensitive)) {
-            content = content.mid(prefix.length()).trimmed();
-            break;
-        }
-    }
-    
-    // Remove quotes if the entire content is wrapped in them
-    if ((content.startsWith('"') && content.endsWith('"')) ||
-        (content.startsWith('\'') && content.endsWith('\''))) {
-        content = content.mid(1, content.length() - 2);
-    }
-    
-    return content.trimmed();
+    QVector<ParsedProblem> problems = ResponseParser::parseProblems(response);
+    return problems.isEmpty() ? QString() : problems.first().statement.trimmed();
 }
 
-QString ProblemGenerator::generateProblemSync(const QString& problemType, const QString& difficulty)
+AiResult<QString> ProblemGenerator::generateProblemSync(const QString& problemType, Difficulty difficulty)
 {
     if (!aiService) {
-        return "Error: AI Service not initialized.";
+        return AiResult<QString>::failure(AIStatusCode::NotConfigured, "AI Service not initialized.");
     }
     
     // Create appropriate prompt
     QString prompt = createPrompt(problemType, difficulty);
     
-    qDebug() << "Generating problem synchronously for:" << problemType << "at" << difficulty << "difficulty";
+    qDebug() << "Generating problem synchronously for:" << problemType << "at" << difficultyName(difficulty) << "difficulty";
     // qDebug() << "Prompt:" << prompt;
     
     // Send prompt to AI service and wait for response
-    QString response = aiService->promptSync(prompt);
+    AiResult<QString> response = aiService->promptSync(prompt);
+    if (!response.ok()) {
+        return response;
+    }
     
     // Extract and clean the problem from the response
-    QString cleanedProblem = extractProblemFromResponse(response);
+    QString cleanedProblem = extractProblemFromResponse(response.value());
     
     if (cleanedProblem.isEmpty()) {
-        return "Error: Received empty or invalid response from AI service.";
+        return AiResult<QString>::failure(response.status().withError(
+            AIStatusCode::InvalidResponse, "Received empty or invalid response from AI service."));
     }
     
-    return cleanedProblem;
+    return AiResult<QString>::success(cleanedProblem, response.status());
 }
 
-GeneratedProblem ProblemGenerator::generateCompleteProblemSync(const QString& problemType, const QString& difficulty, bool forceMultipleChoice)
+AiResult<GeneratedProblem> ProblemGenerator::generateCompleteProblemSync(const QString& problemType, Difficulty difficulty, bool forceMultipleChoice)
 {
+    PIPINO_TRACE_SCOPE("generator", "ProblemGenerator::generateCompleteProblemSync");
     if (!aiService) {
-        return GeneratedProblem("Error: AI Service not initialized.");
+        return AiResult<GeneratedProblem>::failure(AIStatusCode::NotConfigured, "AI Service not initialized.");
     }
     
-    // Determine if we should generate multiple choice based on difficulty, force flag, and current problem type
-    bool isCurrentProblemMC = model && model->isCurrentProblemMultipleChoice();
-    bool shouldGenerateMultipleChoice = forceMultipleChoice || 
-                                       ((difficulty.toLower() == "easy" || difficulty.toLower() == "medium") && isCurrentProblemMC);
+    bool generateMultipleChoice = shouldGenerateMultipleChoice(difficulty, forceMultipleChoice);
     
     QString prompt;
-    if (shouldGenerateMultipleChoice) {
+    if (generateMultipleChoice) {
         prompt = createMultipleChoicePrompt(problemType, difficulty);
     } else {
         prompt = createPrompt(problemType, difficulty);
     }
     
-    qDebug() << "Generating complete problem for:" << problemType << "at" << difficulty << "difficulty";
-    qDebug() << "Multiple choice:" << shouldGenerateMultipleChoice;
+    qDebug() << "Generating complete problem for:" << problemType << "at" << difficultyName(difficulty) << "difficulty";
+    qDebug() << "Multiple choice:" << generateMultipleChoice;
     // qDebug() << "Prompt:" << prompt;
     
     // Send prompt to AI service and wait for response
-    QString response = aiService->promptSync(prompt);
+    AiResult<QString> response = aiService->promptSync(prompt);
     
-    if (response.startsWith("Error:") || response.startsWith("Timeout:")) {
-        return GeneratedProblem(response);
+    bool allowChoices = !model || model->isCurrentProblemMultipleChoice();
+    return toProblemResult(response, generateMultipleChoice, allowChoices);
+}
+
+quint64 ProblemGenerator::generateCompleteProblemAsync(const QString& problemType, Difficulty difficulty,
+                                                       bool multipleChoice, ProblemHandler handler,
+                                                       AIPriority priority)
+{
+    if (!aiService) {
+        if (handler) {
+            handler(AiResult<GeneratedProblem>::failure(AIStatusCode::NotConfigured, "AI Service not initialized."));
+        }
+        return 0;
     }
     
-    if (shouldGenerateMultipleChoice) {
-        return parseMultipleChoiceResponse(response);
-    } else {
-        QString cleanedProblem = extractProblemFromResponse(response);
-        return GeneratedProblem(cleanedProblem);
+    // The multiple choice decision comes from the caller: by the time the response arrives the
+    // user may have selected a different problem, so the model selection is not consulted
+    bool generateMultipleChoice = multipleChoice;
+    QString prompt = generateMultipleChoice ? createMultipleChoicePrompt(problemType, difficulty)
+                                            : createPrompt(problemType, difficulty);
+    
+    qDebug() << "Generating complete problem asynchronously for:" << problemType << "at" << difficultyName(difficulty) << "difficulty";
+    qDebug() << "Multiple choice:" << generateMultipleChoice;
+    
+    return aiService->promptAsync(prompt, [this, generateMultipleChoice, handler](const AiResult<QString>& response) {
+        if (handler) {
+            handler(toProblemResult(response, generateMultipleChoice, true));
+        }
+    }, 10000, priority);
+}
+
+void ProblemGenerator::cancelGeneration(quint64 jobId)
+{
+    if (aiService && jobId != 0) {
+        aiService->cancel(jobId);
     }
 }
 
-QString ProblemGenerator::createMultipleChoicePrompt(const QString& problemType, const QString& difficulty)
+int ProblemGenerator::maxBatchSize()
 {
-    QString difficultyLower = difficulty.toLower();
-    
-    QString basePrompt;
-    if (difficultyLower == "easy") {
-        basePrompt = QString(
-            "Generate a simple %1 multiple choice problem suitable for beginners. "
-            "Requirements:\n"
-            "- Create a clear, easy-to-understand problem statement\n"
-            "- Use basic concepts and simple numbers\n"
-            "- The problem should be solvable in 1-2 steps\n"
-            "- Provide exactly 4 multiple choice options (A, B, C, D)\n"
-            "- Only ONE option should be correct\n"
-            "- Make the incorrect options plausible but clearly wrong\n"
-        ).arg(problemType);
-    } else if (difficultyLower == "medium") {
-        basePrompt = QString(
-            "Generate a %1 multiple choice problem of moderate difficulty. "
-            "Requirements:\n"
-            "- Create a problem that requires multiple steps to solve\n"
-            "- Use intermediate-level concepts and reasonable numbers\n"
-            "- Include some context or real-world application if appropriate\n"
-            "- Provide exactly 4 multiple choice options (A, B, C, D)\n"
-            "- Only ONE option should be correct\n"
-            "- Make the incorrect options result from common mistakes\n"
-        ).arg(problemType);
-    } else {
-        // Hard or other - still generate multiple choice if forced
-        basePrompt = QString(
-            "Generate a challenging %1 multiple choice problem. "
-            "Requirements:\n"
-            "- Create a complex, multi-step problem\n"
-            "- Use advanced concepts and realistic scenarios\n"
-            "- Provide exactly 4 multiple choice options (A, B, C, D)\n"
-            "- Only ONE option should be correct\n"
-            "- Make the incorrect options sophisticated and challenging\n"
-        ).arg(problemType);
+    // Beyond this the answers get long enough that the model starts repeating itself or truncating
+    return 10;
+}
+
+AiResult<QVector<GeneratedProblem>> ProblemGenerator::generateBatch(const QString& problemType, Difficulty difficulty,
+                                                                    int count, bool multipleChoice)
+{
+    PIPINO_TRACE_SCOPE("generator", "ProblemGenerator::generateBatch");
+    if (!aiService) {
+        return AiResult<QVector<GeneratedProblem>>::failure(AIStatusCode::NotConfigured, "AI Service not initialized.");
     }
     
-    QString formatInstructions = 
-        "\n\nFormat your response EXACTLY like this:\n"
-        "PROBLEM: [Your problem statement here]\n"
-        "A) [First option]\n"
-        "B) [Second option]\n"
-        "C) [Third option]\n"
-        "D) [Fourth option]\n"
-        "CORRECT: [A, B, C, or D]\n\n"
-        "Topic: " + problemType + "\n"
-        "Difficulty: " + difficulty;
+    count = qBound(1, count, maxBatchSize());
+    QString prompt = createBatchPrompt(problemType, difficulty, count, multipleChoice);
     
-    return basePrompt + formatInstructions;
+    qDebug() << "Generating batch of" << count << "problems for:" << problemType << "at" << difficultyName(difficulty) << "difficulty";
+    
+    return toBatchResult(aiService->promptSync(prompt), multipleChoice);
 }
 
-GeneratedProblem ProblemGenerator::parseMultipleChoiceResponse(const QString& response)
+quint64 ProblemGenerator::generateBatchAsync(const QString& problemType, Difficulty difficulty, int count,
+                                             bool multipleChoice, BatchHandler handler, AIPriority priority)
 {
-    qDebug() << "Parsing multiple choice response:" << response;
+    if (!aiService) {
+        if (handler) {
+            handler(AiResult<QVector<GeneratedProblem>>::failure(AIStatusCode::NotConfigured, "AI Service not initialized."));
+        }
+        return 0;
+    }
+    
+    count = qBound(1, count, maxBatchSize());
+    QString prompt = createBatchPrompt(problemType, difficulty, count, multipleChoice);
     
-    // Clean up the response
-    QString cleanResponse = response.trimmed();
+    qDebug() << "Generating batch of" << count << "problems asynchronously for:" << problemType << "at" << difficultyName(difficulty) << "difficulty";
     
-    // Try to parse JSON first (in case the API returns JSON)
-    QJsonParseError parseError;
-    QJsonDocument doc = QJsonDocument::fromJson(cleanResponse.toUtf8(), &parseError);
+    // A batch takes proportionally longer to write out than a single problem
+    int timeoutMs = 10000 + 3000 * (count - 1);
     
-    if (parseError.error == QJsonParseError::NoError && doc.isObject()) {
-        QJsonObject obj = doc.object();
-        if (obj.contains("content")) {
-            cleanResponse = obj["content"].toString();
-        } else if (obj.contains("response")) {
-            cleanResponse = obj["response"].toString();
+    return aiService->promptAsync(prompt, [this, multipleChoice, handler](const AiResult<QString>& response) {
+        if (handler) {
+            handler(toBatchResult(response, multipleChoice));
         }
+    }, timeoutMs, priority);
+}
+
+AiResult<GeneratedProblem> ProblemGenerator::toProblemResult(const AiResult<QString>& response, bool multipleChoice,
+                                                             bool allowChoices)
+{
+    PIPINO_TRACE_SCOPE("generator", "ProblemGenerator::parseResponse");
+    if (!response.ok()) {
+        return AiResult<GeneratedProblem>::failure(response.status());
     }
     
-    // Parse the formatted response
-    QStringList lines = cleanResponse.split('\n', Qt::SkipEmptyParts);
+    GeneratedProblem problem = multipleChoice ? parseMultipleChoiceResponse(response.value(), allowChoices)
+                                              : GeneratedProblem(extractProblemFromResponse(response.value()));
+    if (problem.problemStatement.isEmpty()) {
+        return AiResult<GeneratedProblem>::failure(response.status().withError(
+            AIStatusCode::InvalidResponse, "Could not parse problem statement from AI response."));
+    }
+    return AiResult<GeneratedProblem>::success(problem, response.status());
+}
+
+AiResult<QVector<GeneratedProblem>> ProblemGenerator::toBatchResult(const AiResult<QString>& response,
+                                                                    bool multipleChoice)
+{
+    PIPINO_TRACE_SCOPE("generator", "ProblemGenerator::parseBatchResponse");
+    if (!response.ok()) {
+        return AiResult<QVector<GeneratedProblem>>::failure(response.status());
+    }
     
-    QString problemStatement;
-    QVector<MultipleChoiceOption> choices;
-    QString correctAnswer;
+    QVector<GeneratedProblem> problems = parseBatchResponse(response.value(), multipleChoice);
+    if (problems.isEmpty()) {
+        return AiResult<QVector<GeneratedProblem>>::failure(response.status().withError(
+            AIStatusCode::InvalidResponse, "No usable problems in AI response."));
+    }
+    return AiResult<QVector<GeneratedProblem>>::success(problems, response.status());
+}
+
+bool ProblemGenerator::shouldGenerateMultipleChoice(Difficulty difficulty, bool forceMultipleChoice) const
+{
+    // Determine if we should generate multiple choice based on difficulty, force flag, and current problem type
+    bool isCurrentProblemMC = model && model->isCurrentProblemMultipleChoice();
+    return forceMultipleChoice || 
+           (difficulty != Difficulty::Hard && isCurrentProblemMC);
+}
+
+QString ProblemGenerator::createMultipleChoicePrompt(const QString& problemType, Difficulty difficulty)
+{
+    PIPINO_TRACE_SCOPE("generator", "ProblemGenerator::createMultipleChoicePrompt");
+    QString basePrompt = QString(promptsFor(difficulty).multipleChoice).arg(problemType);
     
-    for (const QString& line : lines) {
-        QString trimmedLine = line.trimmed();
-        
-        if (trimmedLine.startsWith("PROBLEM:", Qt::CaseInsensitive)) {
-            problemStatement = trimmedLine.mid(8).trimmed(); // Remove "PROBLEM:"
-        }
-        else if (trimmedLine.startsWith("A)", Qt::CaseInsensitive)) {
-            choices.append(MultipleChoiceOption(trimmedLine, false));
-        }
-        else if (trimmedLine.startsWith("B)", Qt::CaseInsensitive)) {
-            choices.append(MultipleChoiceOption(trimmedLine, false));
-        }
-        else if (trimmedLine.startsWith("C)", Qt::CaseInsensitive)) {
-            choices.append(MultipleChoiceOption(trimmedLine, false));
-        }
-        else if (trimmedLine.startsWith("D)", Qt::CaseInsensitive)) {
-            choices.append(MultipleChoiceOption(trimmedLine, false));
-        }
-        else if (trimmedLine.startsWith("CORRECT:", Qt::CaseInsensitive)) {
-            correctAnswer = trimmedLine.mid(8).trimmed().toUpper(); // Remove "CORRECT:"
+    QString formatInstructions = 
+        ResponseParser::problemFormatInstructions(1, true) +
+        "Topic: " + problemType + "\n"
+        "Difficulty: " + difficultyName(difficulty);
+    
+    return basePrompt + formatInstructions;
+}
+
+QString ProblemGenerator::createBatchPrompt(const QString& problemType, Difficulty difficulty,
+                                           int count, bool multipleChoice)
+{
+    PIPINO_TRACE_SCOPE("generator", "ProblemGenerator::createBatchPrompt");
+    QString level = promptsFor(difficulty).batchLevel;
+    
+    QString prompt = QString(
+        "Generate %1 different %2 problems. "
+        "Requirements:\n"
+        "%3"
+        "- Every problem must be distinct in numbers and context\n"
+        "- Provide only the problem statements, no solutions\n"
+    ).arg(count).arg(problemType, level);
+    
+    if (multipleChoice) {
+        prompt +=
+            "- Give each problem exactly 4 multiple choice options (A, B, C, D)\n"
+            "- Only ONE option per problem should be correct\n"
+            "- Make the incorrect options plausible, e.g. results of common mistakes\n";
+    }
+    
+    prompt += ResponseParser::problemFormatInstructions(count, multipleChoice);
+    prompt += "Topic: " + problemType + "\n"
+              "Difficulty: " + difficultyName(difficulty);
+    return prompt;
+}
+
+QVector<GeneratedProblem> ProblemGenerator::parseBatchResponse(const QString& response, bool multipleChoice)
+{
+    QVector<GeneratedProblem> problems;
+    const QVector<ParsedProblem> parsed = ResponseParser::parseProblems(response);
+    problems.reserve(parsed.size());
+    
+    for (const ParsedProblem& candidate : parsed) {
+        GeneratedProblem problem = multipleChoice ? toMultipleChoiceProblem(candidate, true)
+                                                  : GeneratedProblem(candidate.statement.trimmed());
+        bool valid = !problem.problemStatement.isEmpty() &&
+                     (!multipleChoice || problem.isMultipleChoice);
+        if (valid) {
+            problems.append(problem);
         }
     }
     
+    qDebug() << "Parsed" << problems.size() << "problems from batch response";
+    return problems;
+}
+
+GeneratedProblem ProblemGenerator::parseMultipleChoiceResponse(const QString& response, bool allowChoices)
+{
+    qDebug() << "Parsing multiple choice response:" << response;
+    
+    const QVector<ParsedProblem> parsed = ResponseParser::parseProblems(response);
+    if (parsed.isEmpty()) {
+        return GeneratedProblem(); // An empty statement tells the caller parsing failed
+    }
+    return toMultipleChoiceProblem(parsed.first(), allowChoices);
+}
+
+GeneratedProblem ProblemGenerator::toMultipleChoiceProblem(const ParsedProblem& parsed, bool allowChoices)
+{
+    const QString problemStatement = parsed.statement.trimmed();
+    
+    // Options keep their letter so the dialog buttons read "A) ...", as before
+    QVector<MultipleChoiceOption> choices;
+    choices.reserve(parsed.choices.size());
+    for (int i = 0; i < parsed.choices.size(); ++i) {
+        choices.append(MultipleChoiceOption(QString("%1) %2").arg(QChar('A' + i)).arg(parsed.choices[i]), false));
+    }
+    
     // Mark the correct answer
-    if (!correctAnswer.isEmpty() && choices.size() == 4) {
-        int correctIndex = -1;
-        if (correctAnswer == "A") correctIndex = 0;
-        else if (correctAnswer == "B") correctIndex = 1;
-        else if (correctAnswer == "C") correctIndex = 2;
-        else if (correctAnswer == "D") correctIndex = 3;
-        
-        if (correctIndex >= 0 && correctIndex < choices.size()) {
-            choices[correctIndex].isCorrect = true;
-        }
+    if (choices.size() == 4 && parsed.correctIndex >= 0 && parsed.correctIndex < choices.size()) {
+        choices[parsed.correctIndex].isCorrect = true;
     }
     
     // Validate we have all required parts
     if (problemStatement.isEmpty()) {
-        return GeneratedProblem("Error: Could not parse problem statement from AI response.");
+        return GeneratedProblem();
     }
     
     if (choices.size() != 4) {
@@ -393,23 +460,13 @@ GeneratedProblem ProblemGenerator::parseMultipleChoiceResponse(const QString& re
         return GeneratedProblem(problemStatement);
     }
     
-    // Check if we have exactly one correct answer
-    int correctCount = 0;
-    for (const auto& choice : choices) {
-        if (choice.isCorrect) correctCount++;
-    }
-    
-    if (correctCount != 1) {
-        qDebug() << "Warning: Expected 1 correct answer, got" << correctCount << ". Setting first option as correct.";
-        // Reset all to false and set first as correct
-        for (auto& choice : choices) {
-            choice.isCorrect = false;
-        }
+    if (parsed.correctIndex < 0 || parsed.correctIndex >= choices.size()) {
+        qDebug() << "Warning: No valid correct answer given. Setting first option as correct.";
         choices[0].isCorrect = true;
     }
     
-    // Check if the current problem is actually a multiple choice problem
-    if (model && !model->isCurrentProblemMultipleChoice()) {
+    // Check if the target problem is actually a multiple choice problem
+    if (!allowChoices) {
         qDebug() << "Current problem is not multiple choice, returning as regular problem.";
         return GeneratedProblem(problemStatement);
     }
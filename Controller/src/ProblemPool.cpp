@@ -0,0 +1,261 @@
+#include "ProblemPool.h"
+#include "Model.h"
+#include <QDebug>
+#include <memory>
+
+namespace {
+// How long background refilling pauses after a failed generation
+constexpr int kRetryDelayMs = 30000;
+}
+
+ProblemPool::ProblemPool(ProblemGenerator* gen, QObject *parent)
+    : QObject(parent)
+    , generator(gen)
+    , model(nullptr)
+    , problemsPerKey(2)
+    , maxConcurrentRequests(2)
+    , hitCount(0)
+    , missCount(0)
+    , generatedCount(0)
+    , failureCount(0)
+    , requestCount(0)
+{
+    retryTimer.setSingleShot(true);
+    retryTimer.setInterval(kRetryDelayMs);
+    connect(&retryTimer, &QTimer::timeout, this, &ProblemPool::schedule);
+}
+
+void ProblemPool::setModel(Model* mdl)
+{
+    if (model) {
+        disconnect(model, nullptr, this, nullptr);
+    }
+
+    model = mdl;
+
+    if (model) {
+        connect(model, &Model::userDifficultyChanged, this, &ProblemPool::onUserDifficultyChanged);
+        connect(model, &Model::unitsChanged, this, &ProblemPool::rebuildTargets);
+        connect(model, &Model::unitProblemsChanged, this, &ProblemPool::rebuildTargets);
+    }
+
+    rebuildTargets();
+}
+
+void ProblemPool::setCapacity(int perKey)
+{
+    problemsPerKey = qMax(0, perKey);
+    schedule();
+}
+
+void ProblemPool::setMaxConcurrentRequests(int maxRequests)
+{
+    maxConcurrentRequests = qMax(1, maxRequests);
+    schedule();
+}
+
+ProblemPoolKey ProblemPool::keyFor(TopicId topic, Difficulty difficulty, int problemIndex)
+{
+    return ProblemPoolKey(topic, difficulty, problemIndex < 3);
+}
+
+bool ProblemPool::take(const ProblemPoolKey& key, GeneratedProblem& out)
+{
+    // The key was just asked for, so it is the most useful one to refill next
+    prioritize(key);
+
+    auto it = readyProblems.find(key);
+    if (it == readyProblems.end() || it->isEmpty()) {
+        ++missCount;
+        schedule();
+        return false;
+    }
+
+    out = it->dequeue();
+    ++hitCount;
+    schedule();
+    return true;
+}
+
+void ProblemPool::prefetch(const ProblemPoolKey& key)
+{
+    prioritize(key);
+    schedule();
+}
+
+void ProblemPool::request(const ProblemPoolKey& key)
+{
+    prioritize(key);
+
+    // A prefetch for the key is already on its way; waiting for it beats paying twice
+    bool running = false;
+    for (InFlightJob& job : inFlightJobs) {
+        if (job.key == key) {
+            job.requested = true;
+            running = true;
+        }
+    }
+    if (running) {
+        return;
+    }
+
+    // One problem is enough to unblock the user; schedule() tops the key up afterwards
+    startGeneration(key, 1, AIPriority::Interactive, true);
+}
+
+int ProblemPool::readyCount(const ProblemPoolKey& key) const
+{
+    auto it = readyProblems.constFind(key);
+    return it == readyProblems.constEnd() ? 0 : it->size();
+}
+
+ProblemPool::Stats ProblemPool::stats() const
+{
+    Stats s;
+    s.hits = hitCount;
+    s.misses = missCount;
+    s.generated = generatedCount;
+    s.failures = failureCount;
+    s.requests = requestCount;
+    for (const auto& queue : readyProblems) {
+        s.ready += queue.size();
+    }
+    s.inFlight = inFlightTotal();
+    return s;
+}
+
+void ProblemPool::onUserDifficultyChanged(Difficulty difficulty)
+{
+    qDebug() << "ProblemPool: difficulty changed to" << difficultyName(difficulty) << "- reprioritising prefetch";
+
+    // Background work for the old difficulty would only delay the keys the user needs now
+    const auto jobs = inFlightJobs;
+    for (auto it = jobs.constBegin(); it != jobs.constEnd(); ++it) {
+        if (it.value().key.difficulty != difficulty && !it.value().requested) {
+            generator->cancelGeneration(it.key());
+            inFlightJobs.remove(it.key());
+            releaseJob(it.value());
+        }
+    }
+
+    rebuildTargets();
+}
+
+void ProblemPool::rebuildTargets()
+{
+    targets.clear();
+
+    if (model) {
+        const Difficulty difficulty = model->userDifficulty();
+        const QVector<Unit>& units = model->getUnits();
+        for (const Unit& unit : units) {
+            for (int i = 0; i < unit.problems.size(); ++i) {
+                targets.append(keyFor(unit.problems[i].topic, difficulty, i));
+            }
+        }
+    }
+
+    schedule();
+}
+
+void ProblemPool::prioritize(const ProblemPoolKey& key)
+{
+    targets.removeAll(key);
+    targets.prepend(key);
+}
+
+void ProblemPool::schedule()
+{
+    if (!generator || problemsPerKey <= 0 || retryTimer.isActive()) {
+        return;
+    }
+
+    // Walk the targets in priority order, topping each key up to capacity
+    for (const ProblemPoolKey& key : std::as_const(targets)) {
+        if (inFlightTotal() >= maxConcurrentRequests) {
+            break;
+        }
+
+        int missing = problemsPerKey - readyCount(key) - inFlightPerKey.value(key, 0);
+        if (missing > 0) {
+            startGeneration(key, qMin(missing, ProblemGenerator::maxBatchSize()));
+        }
+    }
+}
+
+void ProblemPool::startGeneration(const ProblemPoolKey& key, int count, AIPriority priority, bool requested)
+{
+    // The job id is only known once generateBatchAsync returns, but the
+    // handler always runs later from the event loop, so it is shared via a pointer
+    auto jobId = std::make_shared<quint64>(0);
+    *jobId = generator->generateBatchAsync(
+        TopicTable::instance().name(key.topic), key.difficulty, count, key.multipleChoice,
+        [this, jobId](const AiResult<QVector<GeneratedProblem>>& result) {
+            onGenerationFinished(*jobId, result);
+        },
+        priority);
+
+    if (*jobId == 0) {
+        ++failureCount;
+        retryTimer.start();
+        if (requested) {
+            emit generationFailed(key, AIStatus::failure(AIStatusCode::NotConfigured, "Problem generator unavailable"));
+        }
+        return;
+    }
+
+    ++requestCount;
+    inFlightJobs.insert(*jobId, InFlightJob{key, count, requested});
+    inFlightPerKey[key] += count;
+}
+
+void ProblemPool::releaseJob(const InFlightJob& job)
+{
+    if ((inFlightPerKey[job.key] -= job.count) <= 0) {
+        inFlightPerKey.remove(job.key);
+    }
+}
+
+void ProblemPool::onGenerationFinished(quint64 jobId, const AiResult<QVector<GeneratedProblem>>& result)
+{
+    auto it = inFlightJobs.find(jobId);
+    if (it == inFlightJobs.end()) {
+        return; // Cancelled after a difficulty change
+    }
+
+    InFlightJob job = it.value();
+    inFlightJobs.erase(it);
+    releaseJob(job);
+
+    const ProblemPoolKey& key = job.key;
+    int added = 0;
+    if (result.ok()) {
+        for (const GeneratedProblem& problem : result.value()) {
+            bool unusable = key.multipleChoice && (!problem.isMultipleChoice || problem.choices.isEmpty());
+            if (!unusable) {
+                readyProblems[key].enqueue(problem);
+                ++added;
+            }
+        }
+    }
+
+    if (added == 0) {
+        ++failureCount;
+        qDebug() << "ProblemPool: background generation failed for" << TopicTable::instance().name(key.topic)
+                 << "(" << (result.ok() ? QString("no usable problems") : result.errorMessage()) << ")"
+                 << "- pausing refill for" << kRetryDelayMs << "ms";
+        retryTimer.start();
+
+        // Only once nothing else for the key is still on its way
+        if (!inFlightPerKey.contains(key)) {
+            emit generationFailed(key, result.ok() ? AIStatus::failure(AIStatusCode::InvalidResponse, "no usable problems")
+                                                   : result.status());
+        }
+        return;
+    }
+
+    generatedCount += added;
+    emit problemReady(key);
+
+    schedule();
+}
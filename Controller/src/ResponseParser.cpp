@@ -0,0 +1,495 @@
+#include "ResponseParser.h"
+#include <QDebug>
+#include <atomic>
+
+namespace {
+const QStringView kProblemsSchema = u"pipino.problems";
+const QStringView kGradeSchema = u"pipino.grade";
+
+// Nesting deeper than this is not part of the contract; stop instead of recursing on garbage
+constexpr int kMaxDepth = 16;
+
+std::atomic<quint64> structuredCount{0};
+std::atomic<quint64> fallbackCount{0};
+std::atomic<quint64> failedCount{0};
+
+// Minimal JSON reader over a QStringView. It only understands what the contract needs
+// and skips everything else; strings come back as views into the response.
+class JsonScanner
+{
+public:
+    explicit JsonScanner(QStringView text, qsizetype start = 0) : s(text), pos(start) {}
+
+    QChar peek() {
+        skipWhitespace();
+        return pos < s.size() ? s[pos] : QChar();
+    }
+
+    bool consume(QChar c) {
+        if (peek() != c) return false;
+        ++pos;
+        return true;
+    }
+
+    // raw is the text between the quotes; escaped says whether it still needs decoding
+    bool readString(QStringView& raw, bool& escaped) {
+        if (!consume(u'"')) return false;
+        const qsizetype begin = pos;
+        escaped = false;
+        while (pos < s.size()) {
+            QChar c = s[pos];
+            if (c == u'\\') {
+                escaped = true;
+                pos += 2;
+            } else if (c == u'"') {
+                raw = s.sliced(begin, pos - begin);
+                ++pos;
+                return true;
+            } else {
+                ++pos;
+            }
+        }
+        return false;
+    }
+
+    bool readString(QString& out) {
+        QStringView raw;
+        bool escaped = false;
+        if (!readString(raw, escaped)) return false;
+        out = escaped ? unescape(raw) : raw.toString();
+        return true;
+    }
+
+    bool readInteger(int& out) {
+        skipWhitespace();
+        const qsizetype begin = pos;
+        while (pos < s.size() && (s[pos].isDigit() || s[pos] == u'-')) ++pos;
+        bool ok = false;
+        out = s.sliced(begin, pos - begin).toInt(&ok);
+        return ok;
+    }
+
+    bool skipValue(int depth = 0) {
+        if (depth > kMaxDepth) return false;
+        QChar c = peek();
+        if (c == u'"') {
+            QStringView raw;
+            bool escaped;
+            return readString(raw, escaped);
+        }
+        if (c == u'{') {
+            return forEachMember([&](QStringView) { return skipValue(depth + 1); });
+        }
+        if (c == u'[') {
+            return forEachElement([&]() { return skipValue(depth + 1); });
+        }
+        // Number, true, false or null
+        const qsizetype begin = pos;
+        while (pos < s.size() && s[pos] != u',' && s[pos] != u'}' && s[pos] != u']' && !s[pos].isSpace()) ++pos;
+        return pos > begin;
+    }
+
+    // Calls onMember(key) for every member; it must consume the value
+    template <typename F>
+    bool forEachMember(F onMember) {
+        if (!consume(u'{')) return false;
+        if (consume(u'}')) return true;
+        do {
+            QStringView rawKey;
+            bool escaped = false;
+            if (!readString(rawKey, escaped) || !consume(u':')) return false;
+            QString decodedKey;
+            if (escaped) {
+                decodedKey = unescape(rawKey);
+                rawKey = decodedKey;
+            }
+            if (!onMember(rawKey)) return false;
+        } while (consume(u','));
+        return consume(u'}');
+    }
+
+    // Calls onElement() for every element; it must consume the value
+    template <typename F>
+    bool forEachElement(F onElement) {
+        if (!consume(u'[')) return false;
+        if (consume(u']')) return true;
+        do {
+            if (!onElement()) return false;
+        } while (consume(u','));
+        return consume(u']');
+    }
+
+    static QString unescape(QStringView raw) {
+        QString out;
+        out.reserve(raw.size());
+        for (qsizetype i = 0; i < raw.size(); ++i) {
+            QChar c = raw[i];
+            if (c != u'\\' || i + 1 >= raw.size()) {
+                out.append(c);
+                continue;
+            }
+            QChar e = raw[++i];
+            switch (e.unicode()) {
+            case 'n': out.append(u'\n'); break;
+            case 't': out.append(u'\t'); break;
+            case 'r': out.append(u'\r'); break;
+            case 'b': out.append(u'\b'); break;
+            case 'f': out.append(u'\f'); break;
+            case 'u':
+                if (i + 4 < raw.size()) {
+                    bool ok = false;
+                    ushort code = raw.sliced(i + 1, 4).toUShort(&ok, 16);
+                    if (ok) {
+                        out.append(QChar(code)); // Surrogate pairs arrive as two escapes
+                        i += 4;
+                        break;
+                    }
+                }
+                out.append(e);
+                break;
+            default: out.append(e); break; // \" \\ \/
+            }
+        }
+        return out;
+    }
+
+private:
+    void skipWhitespace() {
+        while (pos < s.size() && s[pos].isSpace()) ++pos;
+    }
+
+    QStringView s;
+    qsizetype pos;
+};
+
+// "pipino.problems/1" -> true for the expected name at a version this build understands
+bool isSchema(QStringView value, QStringView name)
+{
+    if (!value.startsWith(name) || value.size() <= name.size() + 1 || value[name.size()] != u'/') {
+        return false;
+    }
+    bool ok = false;
+    int version = value.sliced(name.size() + 1).toInt(&ok);
+    return ok && version >= 1 && version <= ResponseParser::kSchemaVersion;
+}
+
+int indexForLetter(QStringView letter)
+{
+    letter = letter.trimmed();
+    if (letter.isEmpty()) return -1;
+    char16_t c = letter[0].toUpper().unicode();
+    return (c >= u'A' && c <= u'D') ? int(c - u'A') : -1;
+}
+
+// Drops a leading "A)" / "A." / "A:" label the model sometimes repeats inside an option
+QStringView stripChoiceLabel(QStringView choice)
+{
+    choice = choice.trimmed();
+    if (choice.size() >= 2 && indexForLetter(choice.first(1)) >= 0 &&
+        (choice[1] == u')' || choice[1] == u'.' || choice[1] == u':')) {
+        return choice.sliced(2).trimmed();
+    }
+    return choice;
+}
+
+bool readProblem(JsonScanner& scanner, ParsedProblem& problem)
+{
+    return scanner.forEachMember([&](QStringView key) {
+        if (key == u"statement") {
+            return scanner.readString(problem.statement);
+        }
+        if (key == u"choices") {
+            return scanner.forEachElement([&]() {
+                QStringView raw;
+                bool escaped = false;
+                if (!scanner.readString(raw, escaped)) return false;
+                if (escaped) {
+                    QString decoded = JsonScanner::unescape(raw);
+                    problem.choices.append(stripChoiceLabel(decoded).toString());
+                } else {
+                    problem.choices.append(stripChoiceLabel(raw).toString());
+                }
+                return true;
+            });
+        }
+        if (key == u"correct") {
+            if (scanner.peek() == u'"') {
+                QStringView raw;
+                bool escaped = false;
+                if (!scanner.readString(raw, escaped)) return false;
+                problem.correctIndex = indexForLetter(raw);
+                return true;
+            }
+            return scanner.readInteger(problem.correctIndex);
+        }
+        return scanner.skipValue();
+    });
+}
+
+bool readGradeDetails(JsonScanner& scanner, ParsedGrade& grade)
+{
+    return scanner.forEachMember([&](QStringView key) {
+        if (key == u"noticed") {
+            return scanner.readString(grade.noticed);
+        }
+        if (key == u"strengths") {
+            return scanner.readString(grade.strengths);
+        }
+        if (key == u"improve") {
+            return scanner.readString(grade.improvements);
+        }
+        if (key == u"nextTime") {
+            return scanner.readString(grade.nextTime);
+        }
+        if (key == u"encouragement") {
+            return scanner.readString(grade.encouragement);
+        }
+        return scanner.skipValue();
+    });
+}
+
+enum class Envelope { None, Problems, Grade };
+
+// Reads the first JSON object in text (models like to wrap it in ``` fences or prose).
+// The backend may also wrap the model output in {"content": "..."}; that text is returned
+// in unwrapped so the caller can parse it again.
+Envelope readStructured(QStringView text, QVector<ParsedProblem>* problems, ParsedGrade* grade, QString* unwrapped)
+{
+    qsizetype start = text.indexOf(u'{');
+    if (start < 0) {
+        return Envelope::None;
+    }
+
+    JsonScanner scanner(text, start);
+    QStringView schema;
+    QString decodedSchema;
+    QVector<ParsedProblem> foundProblems;
+    ParsedGrade foundGrade;
+
+    bool ok = scanner.forEachMember([&](QStringView key) {
+        if (key == u"schema") {
+            bool escaped = false;
+            if (!scanner.readString(schema, escaped)) return false;
+            if (escaped) {
+                decodedSchema = JsonScanner::unescape(schema);
+                schema = decodedSchema;
+            }
+            return true;
+        }
+        if (key == u"problems" && problems) {
+            return scanner.forEachElement([&]() {
+                ParsedProblem problem;
+                if (!readProblem(scanner, problem)) return false;
+                foundProblems.append(std::move(problem));
+                return true;
+            });
+        }
+        if (key == u"grade" && grade) {
+            return scanner.readString(foundGrade.grade);
+        }
+        if (key == u"feedback" && grade) {
+            return scanner.readString(foundGrade.feedback);
+        }
+        if (key == u"details" && grade && scanner.peek() == u'{') {
+            return readGradeDetails(scanner, foundGrade);
+        }
+        if ((key == u"content" || key == u"response") && unwrapped && scanner.peek() == u'"') {
+            return scanner.readString(*unwrapped);
+        }
+        return scanner.skipValue();
+    });
+
+    if (!ok) {
+        return Envelope::None;
+    }
+    if (problems && isSchema(schema, kProblemsSchema)) {
+        *problems = std::move(foundProblems);
+        return Envelope::Problems;
+    }
+    if (grade && isSchema(schema, kGradeSchema)) {
+        *grade = std::move(foundGrade);
+        return Envelope::Grade;
+    }
+    return Envelope::None;
+}
+
+// "PROBLEM:" or "PROBLEM 3:" -> the text after the colon
+bool readProblemHeader(QStringView line, QStringView& rest)
+{
+    if (!line.startsWith(u"PROBLEM", Qt::CaseInsensitive)) return false;
+    qsizetype colon = line.indexOf(u':');
+    if (colon < 0 || colon > 12) return false;
+    for (qsizetype i = 7; i < colon; ++i) {
+        if (!line[i].isDigit() && !line[i].isSpace()) return false;
+    }
+    rest = line.sliced(colon + 1).trimmed();
+    return true;
+}
+
+// Older line-based format: PROBLEM: / A) .. D) / CORRECT:, optionally numbered and repeated
+QVector<ParsedProblem> parseLegacyProblems(QStringView text)
+{
+    QVector<ParsedProblem> problems;
+    ParsedProblem current;
+    bool inProblem = false;
+
+    auto finish = [&]() {
+        if (inProblem && !current.statement.isEmpty()) {
+            problems.append(std::move(current));
+        }
+        current = ParsedProblem();
+        inProblem = false;
+    };
+
+    qsizetype start = 0;
+    while (start < text.size()) {
+        qsizetype end = text.indexOf(u'\n', start);
+        if (end < 0) end = text.size();
+        QStringView line = text.sliced(start, end - start).trimmed();
+        start = end + 1;
+
+        QStringView rest;
+        if (line.isEmpty() || line == u"---") {
+            continue;
+        } else if (readProblemHeader(line, rest)) {
+            finish();
+            current.statement = rest.toString();
+            inProblem = true;
+        } else if (!inProblem) {
+            continue;
+        } else if (line.size() >= 2 && line[1] == u')' && indexForLetter(line.first(1)) >= 0) {
+            current.choices.append(line.sliced(2).trimmed().toString());
+        } else if (line.startsWith(u"CORRECT:", Qt::CaseInsensitive)) {
+            current.correctIndex = indexForLetter(line.sliced(8));
+        } else if (current.choices.isEmpty()) {
+            // Statements may wrap onto several lines before the options start
+            current.statement += u' ';
+            current.statement += line;
+        }
+    }
+    finish();
+    return problems;
+}
+
+// Free text with no markers at all: the whole answer is the statement
+QStringView cleanFreeText(QStringView content)
+{
+    content = content.trimmed();
+
+    // Remove common prefixes that might be added by the LLM
+    static const QStringView prefixesToRemove[] = {
+        u"Problem Statement:",
+        u"Problem:",
+        u"Here's a problem:",
+        u"Here is a problem:",
+        u"Generated problem:",
+        u"Math problem:"
+    };
+    for (QStringView prefix : prefixesToRemove) {
+        if (content.startsWith(prefix, Qt::CaseInsensitive)) {
+            content = content.sliced(prefix.size()).trimmed();
+            break;
+        }
+    }
+
+    // Remove quotes if the entire content is wrapped in them
+    if (content.size() >= 2 &&
+        ((content.startsWith(u'"') && content.endsWith(u'"')) ||
+         (content.startsWith(u'\'') && content.endsWith(u'\'')))) {
+        content = content.sliced(1, content.size() - 2);
+    }
+    return content.trimmed();
+}
+}
+
+QVector<ParsedProblem> ResponseParser::parseProblems(QStringView response)
+{
+    QVector<ParsedProblem> problems;
+    QString unwrapped;
+    if (readStructured(response, &problems, nullptr, &unwrapped) == Envelope::Problems && !problems.isEmpty()) {
+        ++structuredCount;
+        return problems;
+    }
+    if (!unwrapped.isEmpty()) {
+        return parseProblems(unwrapped);
+    }
+
+    problems = parseLegacyProblems(response);
+    if (problems.isEmpty()) {
+        QStringView freeText = cleanFreeText(response);
+        if (!freeText.isEmpty() && !freeText.startsWith(u'{')) {
+            ParsedProblem problem;
+            problem.statement = freeText.toString();
+            problems.append(std::move(problem));
+        }
+    }
+
+    if (problems.isEmpty()) {
+        ++failedCount;
+    } else {
+        ++fallbackCount;
+        qDebug() << "ResponseParser: response did not follow the JSON contract, used text fallback ("
+                 << fallbackCount.load() << "so far )";
+    }
+    return problems;
+}
+
+bool ResponseParser::parseGrade(QStringView response, ParsedGrade& grade)
+{
+    QString unwrapped;
+    if (readStructured(response, nullptr, &grade, &unwrapped) == Envelope::Grade && !grade.grade.isEmpty()) {
+        ++structuredCount;
+        return true;
+    }
+    if (!unwrapped.isEmpty()) {
+        return parseGrade(unwrapped, grade);
+    }
+    return false;
+}
+
+void ResponseParser::recordFallback()
+{
+    ++fallbackCount;
+}
+
+QString ResponseParser::problemFormatInstructions(int count, bool multipleChoice)
+{
+    QString problem = multipleChoice
+        ? "{\"statement\": \"[Problem statement]\", "
+          "\"choices\": [\"[Option A]\", \"[Option B]\", \"[Option C]\", \"[Option D]\"], "
+          "\"correct\": \"[A, B, C, or D]\"}"
+        : "{\"statement\": \"[Problem statement]\"}";
+
+    return QString(
+        "\n\nRespond with ONLY this JSON object and no other text:\n"
+        "{\"schema\": \"%1/%2\", \"problems\": [%3]}\n"
+        "The \"problems\" array must contain exactly %4 problem%5.\n\n"
+    ).arg(kProblemsSchema.toString()).arg(kSchemaVersion).arg(problem).arg(count).arg(count == 1 ? "" : "s");
+}
+
+QString ResponseParser::gradeFormatInstructions(bool withDetails)
+{
+    QString details = withDetails
+        ? ", \"details\": {"
+          "\"noticed\": \"[Their approach, and any errors or misconceptions explained gently]\", "
+          "\"strengths\": \"[Specific strengths and correct steps]\", "
+          "\"improve\": \"[Constructive suggestions for improvement]\", "
+          "\"nextTime\": \"[Specific tips for similar problems]\", "
+          "\"encouragement\": \"[Encouraging, personalized message]\"}"
+        : "";
+
+    return QString(
+        "Respond with ONLY this JSON object and no other text:\n"
+        "{\"schema\": \"%1/%2\", \"grade\": \"[A/B/C/D/F]\", "
+        "\"feedback\": \"[One sentence - just confirm if correct or mention the main issue]\"%3}\n"
+    ).arg(kGradeSchema.toString()).arg(kSchemaVersion).arg(details);
+}
+
+ResponseParser::Stats ResponseParser::stats()
+{
+    Stats s;
+    s.structured = structuredCount.load();
+    s.fallback = fallbackCount.load();
+    s.failed = failedCount.load();
+    return s;
+}
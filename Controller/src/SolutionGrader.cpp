@@ -1,17 +1,35 @@
 #include "SolutionGrader.h"
+#include "ResponseParser.h"
+#include "Trace.h"
 #include <QDebug>
 #include <QJsonDocument>
 #include <QJsonObject>
 
+namespace {
+// Graded solutions whose detailed review is kept for "explain more"
+constexpr int kMaxCachedDetails = 16;
+}
+
 SolutionGrader::SolutionGrader(QObject *parent)
     : QObject(parent), aiService(nullptr)
 {
     // Initialize AI service
     aiService = new AIService(this);
     
+    // The student is waiting on the grade, so it goes ahead of background prefetches
+    aiService->setPriority(AIPriority::Interactive);
+    
     // Connect AI service signals
     connect(aiService, &AIService::finished, this, &SolutionGrader::handleAIResponse);
     connect(aiService, &AIService::errorOccurred, this, &SolutionGrader::handleAIError);
+    
+    // Streamed feedback is forwarded piece by piece; the final text gets the usual formatting
+    connect(aiService, &AIService::chunkReceived, this, &SolutionGrader::feedbackChunk);
+    connect(aiService, &AIService::streamFinished, this, [this](quint64 requestId, const AiResult<QString>& response) {
+        emit feedbackStreamFinished(requestId, response.map([this](const QString& text) {
+            return extractGradingFeedback(text);
+        }));
+    });
 }
 
 SolutionGrader::~SolutionGrader()
@@ -19,28 +37,46 @@ SolutionGrader::~SolutionGrader()
     // AI service will be automatically deleted as it's a child of this object
 }
 
-QString SolutionGrader::gradeSolution(const QString& userSolution, const QString& problemStatement)
+AiResult<QString> SolutionGrader::gradeSolution(const QString& userSolution, const QString& problemStatement)
 {
+    PIPINO_TRACE_SCOPE("grader", "SolutionGrader::gradeSolution");
     if (!aiService) {
-        return "Error: AI Service not initialized.";
+        return AiResult<QString>::failure(AIStatusCode::NotConfigured, "AI Service not initialized.");
     }
     
     // Create grading prompt
-    QString prompt = createGradingPrompt(userSolution, problemStatement);
+    QString prompt = createGradingPrompt(userSolution, problemStatement, true);
     
     qDebug() << "Grading solution for problem:" << problemStatement;
     qDebug() << "User solution:" << userSolution;
     // qDebug() << "Grading prompt:" << prompt;
     
     // Send prompt to AI service and wait for response
-    QString response = aiService->promptSync(prompt);
+    AiResult<QString> response = aiService->promptSync(prompt);
     
-    if (response.startsWith("Error:") || response.startsWith("Timeout:")) {
-        return response;
+    // The grading prompt asks for the JSON contract; anything else goes through the text fallback
+    return response.map([&](const QString& text) {
+        ParsedGrade grade;
+        if (ResponseParser::parseGrade(text, grade)) {
+            // Keep the review for a later getDetailedFeedback(); the short grade is shown first
+            if (grade.hasDetails()) {
+                cacheDetailedFeedback(detailKey(userSolution, problemStatement), formatDetailedFeedback(grade));
+            }
+            return formatGrade(grade);
+        }
+        ResponseParser::recordFallback();
+        return extractGradingFeedback(text);
+    });
+}
+
+QString SolutionGrader::formatSolutionSteps(const QStringList& solutionSteps)
+{
+    QStringList numbered;
+    numbered.reserve(solutionSteps.size());
+    for (int i = 0; i < solutionSteps.size(); ++i) {
+        numbered.append(QString("Step %1: %2").arg(i + 1).arg(solutionSteps[i]));
     }
-    
-    // Extract and format the grading feedback
-    return extractGradingFeedback(response);
+    return numbered.join('\n');
 }
 
 void SolutionGrader::gradeSolutionAsync(const QString& userSolution, const QString& problemStatement)
@@ -50,8 +86,9 @@ void SolutionGrader::gradeSolutionAsync(const QString& userSolution, const QStri
         return;
     }
     
-    // Create grading prompt
-    QString prompt = createGradingPrompt(userSolution, problemStatement);
+    // Create grading prompt. The signal carries no request id to file a review under, so
+    // the async path asks for the short grade only.
+    QString prompt = createGradingPrompt(userSolution, problemStatement, false);
     
     qDebug() << "Grading solution asynchronously for problem:" << problemStatement;
     qDebug() << "User solution:" << userSolution;
@@ -61,10 +98,18 @@ void SolutionGrader::gradeSolutionAsync(const QString& userSolution, const QStri
     aiService->prompt(prompt);
 }
 
-QString SolutionGrader::getDetailedFeedback(const QString& userSolution, const QString& problemStatement)
+AiResult<QString> SolutionGrader::getDetailedFeedback(const QString& userSolution, const QString& problemStatement)
 {
+    PIPINO_TRACE_SCOPE("grader", "SolutionGrader::getDetailedFeedback");
     if (!aiService) {
-        return "Error: AI Service not initialized.";
+        return AiResult<QString>::failure(AIStatusCode::NotConfigured, "AI Service not initialized.");
+    }
+    
+    // Revealing the review that came with the grade costs no request
+    auto cached = detailCache.constFind(detailKey(userSolution, problemStatement));
+    if (cached != detailCache.constEnd()) {
+        qDebug() << "Detailed feedback taken from the grading response";
+        return AiResult<QString>::success(*cached);
     }
     
     // Create detailed feedback prompt
@@ -75,14 +120,33 @@ QString SolutionGrader::getDetailedFeedback(const QString& userSolution, const Q
     // qDebug() << "Detailed feedback prompt:" << prompt;
     
     // Send prompt to AI service and wait for response
-    QString response = aiService->promptSync(prompt);
-    
-    if (response.startsWith("Error:") || response.startsWith("Timeout:")) {
-        return response;
-    }
+    AiResult<QString> response = aiService->promptSync(prompt);
     
     // Extract and format the detailed feedback
-    return extractGradingFeedback(response);
+    return response.map([this](const QString& text) {
+        return extractGradingFeedback(text);
+    });
+}
+
+bool SolutionGrader::hasDetailedFeedback(const QString& userSolution, const QString& problemStatement) const
+{
+    return detailCache.contains(detailKey(userSolution, problemStatement));
+}
+
+QString SolutionGrader::detailKey(const QString& userSolution, const QString& problemStatement)
+{
+    return problemStatement + QChar(u'\0') + userSolution;
+}
+
+void SolutionGrader::cacheDetailedFeedback(const QString& key, const QString& feedback)
+{
+    if (!detailCache.contains(key)) {
+        detailCacheOrder.append(key);
+        if (detailCacheOrder.size() > kMaxCachedDetails) {
+            detailCache.remove(detailCacheOrder.takeFirst());
+        }
+    }
+    detailCache.insert(key, feedback);
 }
 
 void SolutionGrader::getDetailedFeedbackAsync(const QString& userSolution, const QString& problemStatement)
@@ -92,6 +156,12 @@ void SolutionGrader::getDetailedFeedbackAsync(const QString& userSolution, const
         return;
     }
     
+    auto cached = detailCache.constFind(detailKey(userSolution, problemStatement));
+    if (cached != detailCache.constEnd()) {
+        emit gradingComplete(*cached);
+        return;
+    }
+    
     // Create detailed feedback prompt
     QString prompt = createDetailedFeedbackPrompt(userSolution, problemStatement);
     
@@ -103,27 +173,57 @@ void SolutionGrader::getDetailedFeedbackAsync(const QString& userSolution, const
     aiService->prompt(prompt);
 }
 
-QString SolutionGrader::createGradingPrompt(const QString& userSolution, const QString& problemStatement)
+quint64 SolutionGrader::streamDetailedFeedback(const QString& userSolution, const QString& problemStatement)
 {
+    if (!aiService) {
+        return 0;
+    }
+    
+    QString prompt = createDetailedFeedbackPrompt(userSolution, problemStatement);
+    
+    qDebug() << "Streaming detailed feedback for problem:" << problemStatement;
+    qDebug() << "User solution:" << userSolution;
+    
+    return aiService->stream(prompt);
+}
+
+quint64 SolutionGrader::streamDetailedFeedback(const QStringList& solutionSteps, const QString& problemStatement)
+{
+    return streamDetailedFeedback(formatSolutionSteps(solutionSteps), problemStatement);
+}
+
+void SolutionGrader::cancelStream(quint64 requestId)
+{
+    if (aiService && requestId != 0) {
+        aiService->cancel(requestId);
+    }
+}
+
+QString SolutionGrader::createGradingPrompt(const QString& userSolution, const QString& problemStatement, bool withDetails)
+{
+    PIPINO_TRACE_SCOPE("grader", "SolutionGrader::createGradingPrompt");
+    QString details = withDetails
+        ? "Keep the grade feedback very brief. Also fill in \"details\" with a fuller review; it is "
+          "only shown if the student asks to know more, so be encouraging, educational, and helpful "
+          "there, and focus on learning and growth.\n\n"
+        : "Keep it very brief. The student can ask for detailed feedback if needed.\n\n";
     QString prompt = QString(
-        "You are an expert math tutor. Grade the following student's solution and provide ONLY a simple grade and brief feedback.\n\n"
+        "You are an expert math tutor. Grade the following student's solution with a simple grade and brief feedback.\n\n"
         "PROBLEM:\n%1\n\n"
         "STUDENT'S SOLUTION:\n%2\n\n"
-        "Provide ONLY:\n"
-        "🎯 **Grade: [A/B/C/D/F]**\n"
-        "[One sentence feedback - just confirm if correct or mention the main issue]\n\n"
-        "Examples:\n"
-        "- \"🎯 Grade: A - Correct!\"\n"
-        "- \"🎯 Grade: C - You used addition instead of multiplication for area.\"\n"
-        "- \"🎯 Grade: B - Right answer, but check your arithmetic in step 2.\"\n\n"
-        "Keep it very brief. The student can ask for detailed feedback if needed."
-    ).arg(problemStatement, userSolution);
+        "Examples of feedback:\n"
+        "- Grade A: \"Correct!\"\n"
+        "- Grade C: \"You used addition instead of multiplication for area.\"\n"
+        "- Grade B: \"Right answer, but check your arithmetic in step 2.\"\n\n"
+        "%3"
+    ).arg(problemStatement, userSolution, details) + ResponseParser::gradeFormatInstructions(withDetails);
     
     return prompt;
 }
 
 QString SolutionGrader::createDetailedFeedbackPrompt(const QString& userSolution, const QString& problemStatement)
 {
+    PIPINO_TRACE_SCOPE("grader", "SolutionGrader::createDetailedFeedbackPrompt");
     QString prompt = QString(
         "You are an expert math tutor. The student has asked for detailed feedback on their solution.\n\n"
         "PROBLEM:\n%1\n\n"
@@ -147,8 +247,35 @@ QString SolutionGrader::createDetailedFeedbackPrompt(const QString& userSolution
     return prompt;
 }
 
+QString SolutionGrader::formatGrade(const ParsedGrade& grade)
+{
+    return QString("🎯 **Grade: %1** - %2").arg(grade.grade.trimmed(), grade.feedback.trimmed());
+}
+
+QString SolutionGrader::formatDetailedFeedback(const ParsedGrade& grade)
+{
+    QString feedback = QString("🎯 **Grade: %1**\n\n"
+                               "Hi! Let me give you detailed feedback on your solution:").arg(grade.grade.trimmed());
+    
+    auto addSection = [&feedback](const char* heading, const QString& text) {
+        if (!text.trimmed().isEmpty()) {
+            feedback += QString("\n\n**%1**\n%2").arg(QLatin1String(heading), text.trimmed());
+        }
+    };
+    addSection("What I noticed:", grade.noticed);
+    addSection("You did really well with:", grade.strengths);
+    addSection("To make it even better:", grade.improvements);
+    addSection("Next time, try:", grade.nextTime);
+    
+    if (!grade.encouragement.trimmed().isEmpty()) {
+        feedback += QString("\n\n**Keep it up!** %1").arg(grade.encouragement.trimmed());
+    }
+    return feedback;
+}
+
 QString SolutionGrader::extractGradingFeedback(const QString& response)
 {
+    PIPINO_TRACE_SCOPE("grader", "SolutionGrader::extractGradingFeedback");
     // Try to parse as JSON first (in case the API returns JSON)
     QJsonParseError parseError;
     QJsonDocument doc = QJsonDocument::fromJson(response.toUtf8(), &parseError);
@@ -215,7 +342,10 @@ void SolutionGrader::handleAIResponse(const QString& response)
     qDebug() << "AI Grading Response received:" << response;
     
     // Extract the feedback from the response
-    QString feedback = extractGradingFeedback(response);
+    // Short grades follow the JSON contract; detailed feedback is free-form chat text
+    ParsedGrade grade;
+    QString feedback = ResponseParser::parseGrade(response, grade) ? formatGrade(grade)
+                                                                   : extractGradingFeedback(response);
     
     if (feedback.isEmpty()) {
         emit gradingError("Received empty or invalid response from AI service.");
@@ -0,0 +1,50 @@
+#ifndef CURRICULUMSYMBOLS_H
+#define CURRICULUMSYMBOLS_H
+
+#include <QString>
+#include <QStringView>
+#include <QHash>
+#include <QVector>
+#include <QReadWriteLock>
+
+// Difficulty of a problem and of the user's setting. Values index the prompt tables in
+// ProblemGenerator, so keep them dense and in this order.
+enum class Difficulty : quint8 {
+    Easy,
+    Medium,
+    Hard
+};
+
+constexpr int kDifficultyCount = 3;
+
+// Canonical display name ("Easy", "Medium", "Hard"); shared, so returning it never allocates
+const QString& difficultyName(Difficulty difficulty);
+
+// Case-insensitive; anything that is not one of the three names gives fallback
+Difficulty difficultyFromString(QStringView text, Difficulty fallback = Difficulty::Medium);
+bool isDifficultyName(QStringView text);
+
+// Interned topic (problem name) symbol; 0 means "no topic"
+using TopicId = quint32;
+
+// Process-wide table of topic names. Every problem with the same name shares one
+// TopicId and one string buffer, and topic keys hash and compare as integers.
+class TopicTable
+{
+public:
+    static TopicTable& instance();
+
+    // Same name, same id; ids are only stable within one run
+    TopicId intern(const QString& name);
+    QString name(TopicId id) const; // Empty for 0 or unknown ids
+    int size() const;
+
+private:
+    TopicTable() = default;
+
+    mutable QReadWriteLock lock;
+    QHash<QString, TopicId> ids;
+    QVector<QString> names; // names[id - 1]
+};
+
+#endif // CURRICULUMSYMBOLS_H
@@ -4,8 +4,22 @@
 #include <QString>
 #include <QStringList>
 #include <QVector>
+#include <QHash>
 #include <QObject>
+#include <QFuture>
+#include <QSet>
+#include <QThreadPool>
+#include <QTimer>
+#include <memory>
 #include "OcrScanner.h"
+#include "CurriculumSymbols.h"
+
+class OcrEnginePool;
+class ModelSnapshot;
+
+// Stable identity of a problem; unlike (unitIndex, problemIndex) it survives removals.
+// 0 means "no problem".
+using ProblemId = quint64;
 
 struct MultipleChoiceOption {
     QString text;
@@ -16,14 +30,17 @@ struct MultipleChoiceOption {
 };
 
 struct Problem {
+    ProblemId id = 0;  // Assigned by the Model when the problem is added
+    TopicId topic = 0; // Interned name, assigned by the Model alongside the ID
     QString name;
     QString description;
-    QString difficulty;
+    Difficulty difficulty;
     QString problemStatement;
     QString theoryContent;
     QVector<MultipleChoiceOption> choices;
+    int correctChoiceIndex = -1; // Index of the correct choice, kept in step with choices by the Model
     
-    Problem(const QString& n = "", const QString& desc = "", const QString& diff = "Easy") 
+    Problem(const QString& n = "", const QString& desc = "", Difficulty diff = Difficulty::Easy) 
         : name(n), description(desc), difficulty(diff) {}
 };
 
@@ -40,38 +57,77 @@ struct Unit {
     }
 };
 
+// Everything a problem dialog shows, gathered in one lookup. The strings and the
+// choice vector are implicitly shared with the Model, so taking a view copies nothing.
+struct ProblemView {
+    bool valid = false;          // False if the indices did not name a problem
+    ProblemId id = 0;
+    QString unitName;
+    QString problemName;
+    QString statement;           // Empty while the problem is being generated
+    bool hasContent = false;     // statement is generated content, not empty or a placeholder
+    QVector<MultipleChoiceOption> choices;
+    int correctChoiceIndex = 1;  // Option B when the choices do not mark one
+
+    QString title() const { return QString("%1: %2").arg(unitName, problemName); }
+};
+
 class Model : public QObject
 {
     Q_OBJECT
 
 public:
     explicit Model(QObject *parent = nullptr);
+    ~Model();
     
     // Unit management
     void addUnit(const Unit& unit);
     void removeUnit(int index);
     const QVector<Unit>& getUnits() const;
     Unit* getUnit(int index);
+    const Unit* getUnit(int index) const;
     int getUnitCount() const;
     
+    // Lookup by stable ID - O(1) through the ID index, no copies
+    ProblemId problemId(int unitIndex, int problemIndex) const;   // 0 if the indices are out of range
+    const Problem* findProblem(ProblemId id) const;               // nullptr if the ID is unknown
+    bool locateProblem(ProblemId id, int& unitIndex, int& problemIndex) const;
+    
     // Problem management for specific units
     void addProblemToUnit(int unitIndex, const Problem& problem);
     void removeProblemFromUnit(int unitIndex, int problemIndex);
     QStringList getProblemsForUnit(int unitIndex) const;
     
-    // Update problem content (for AI-generated problems)
+    // Update problem content (for AI-generated problems). persist = false is for
+    // placeholders ("generating", errors): they are shown, but the snapshot keeps the
+    // problem's last persisted content until a persisting update replaces them.
     void updateProblemContent(int unitIndex, int problemIndex, 
                              const QString& problemStatement, 
-                             const QVector<MultipleChoiceOption>& choices);
+                             const QVector<MultipleChoiceOption>& choices,
+                             bool persist = true);
+    void updateProblemContent(ProblemId id,
+                             const QString& problemStatement,
+                             const QVector<MultipleChoiceOption>& choices,
+                             bool persist = true);
+    
+    // True (once) if the problem still shows generated content restored from the snapshot,
+    // so the first selection after a restart can show it instead of generating again
+    bool takeRestoredContent(ProblemId id);
     
     // Initialize with sample data
     void initializeSampleData();
     
+    // Persistence - the curriculum (including generated content) is restored from a binary
+    // snapshot at startup and changed units are written back in the background
+    void saveSnapshot();                               // Writes pending changes now instead of after the debounce
+    bool exportJson(const QString& jsonPath) const;    // Readable copy of the curriculum for inspection
+    
     // Problem content methods
     QString getProblemStatement(int unitIndex, int problemIndex) const;
     QString getTheoryContent(int unitIndex, int problemIndex) const;
-    QVector<MultipleChoiceOption> getMultipleChoiceOptions(int unitIndex, int problemIndex) const;
+    const QVector<MultipleChoiceOption>& getMultipleChoiceOptions(int unitIndex, int problemIndex) const;
     int getCorrectChoiceIndex(int unitIndex, int problemIndex) const;
+    ProblemView problemView(int unitIndex, int problemIndex) const; // Statement, choices and answer in one call
     
     // Utility methods for string conversion
     QString unitProblemToString(int unitIndex, int problemIndex) const;
@@ -85,28 +141,69 @@ public:
     void setCurrentSelection(int unitIndex, int problemIndex); // Sets the current selection
     
     // User settings methods
-    void setUserDifficulty(const QString& difficulty); // Sets the user's difficulty preference
+    void setUserDifficulty(Difficulty difficulty); // Sets the user's difficulty preference
+    void setUserDifficulty(const QString& difficulty); // Same, from a difficulty name (unknown names mean Medium)
+    Difficulty userDifficulty() const; // Gets the user's difficulty preference
     QString getUserDifficulty() const; // Gets the user's difficulty preference as QString
     
     // OCR methods
-    QString scanImage(const QString& imagePath); // Scans an image and returns OCR text
+    void warmUpOcr(); // Loads Tesseract in the background so the first scan does not wait for it
+    QString scanImage(const QString& imagePath); // Scans an image and returns OCR text (waits for warm-up)
+    QFuture<OcrResult> scanImageAsync(const QString& imagePath); // Same, in the background; reports progress 0-100 and can be cancelled
+    QFuture<QString> scanImages(const QStringList& imagePaths); // Scans a stack of pages in parallel, results in input order
 
 signals:
     void unitsChanged();
     void unitProblemsChanged(int unitIndex);
+    void problemContentChanged(int unitIndex, int problemIndex); // Statement/choices replaced (e.g. AI generation finished)
+    void userDifficultyChanged(Difficulty difficulty);
 
 private:
     QVector<Unit> units;
     
+    // Problem ID -> current position, kept in step with every structural change
+    struct ProblemSlot {
+        int unitIndex;
+        int problemIndex;
+    };
+    QHash<ProblemId, ProblemSlot> problemSlots;
+    ProblemId nextProblemId;
+    const Problem* problemAt(int unitIndex, int problemIndex) const;
+    static int findCorrectChoice(const QVector<MultipleChoiceOption>& choices); // -1 if none is marked
+    bool assignProblemIds(Unit& unit);  // Gives problems without an ID a fresh one and interns their topic; true if any IDs were assigned
+    void indexUnit(int unitIndex);      // Points the slots of every problem in the unit at their current position
+    
     // Current selection tracking
     int currentUnitIndex;    // Currently selected unit index (-1 if none selected)
     int currentProblemIndex; // Currently selected problem index (-1 if none selected)
     
     // User settings
-    QString userDifficultySetting; // User's chosen difficulty setting ("Easy", "Medium", "Hard")
+    Difficulty userDifficultySetting; // User's chosen difficulty setting
     
     // OCR scanner instance
     OcrScanner ocrScanner;
+    
+    // Multi-engine pool for batch scans, created on first use
+    std::unique_ptr<OcrEnginePool> ocrEnginePool;
+    OcrEnginePool& ocrPool();
+    
+    // Snapshot persistence
+    std::unique_ptr<ModelSnapshot> snapshot;
+    QSet<int> dirtyUnits;        // Units changed since the last write was queued
+    QTimer snapshotTimer;        // Debounces writes so a burst of edits becomes one append
+    QThreadPool snapshotWriter;  // Single thread, so writes reach the file in order
+    void markUnitDirty(int unitIndex);
+    void markAllUnitsDirty();
+    
+    // Problems currently showing a placeholder, with the content the snapshot keeps for them
+    struct PersistedContent {
+        QString problemStatement;
+        QVector<MultipleChoiceOption> choices;
+        int correctChoiceIndex;
+    };
+    QHash<ProblemId, PersistedContent> placeholderContent;
+    QSet<ProblemId> restoredContent;       // Snapshot content not yet shown or replaced this session
+    QVector<Unit> persistentUnits() const; // units with every placeholder swapped back
 };
 
 #endif // MODEL_H
@@ -0,0 +1,51 @@
+#ifndef MODELSNAPSHOT_H
+#define MODELSNAPSHOT_H
+
+#include <QString>
+#include <QVector>
+#include <QSet>
+#include <QPair>
+
+struct Unit;
+
+// Versioned binary snapshot of the curriculum, including AI-generated problem content.
+//
+// Layout (little endian):
+//   header  quint32 magic | quint32 version | quint32 unitCount | quint32 reserved | quint64 tableOffset
+//   records one QDataStream-encoded Unit per record, anywhere after the header
+//   table   unitCount x (quint64 offset | quint32 size), at tableOffset
+//
+// Loading maps the file and decodes each unit straight from the mapping. Saving only
+// appends the records of units that changed plus a new table, then repoints the header,
+// so a crash mid-write leaves the previous table valid. The file is rewritten from
+// scratch when the number of units changes or stale records make up most of it.
+class ModelSnapshot
+{
+public:
+    static constexpr quint32 kFormatVersion = 3; // 2: problems carry their stable ID, 3: difficulty as an enum
+
+    explicit ModelSnapshot(const QString& filePath);
+
+    // curriculum.snapshot in the application data directory
+    static QString defaultPath();
+    const QString& path() const { return filePath; }
+
+    // False if the file is missing, damaged or from a newer format version
+    bool load(QVector<Unit>& units);
+
+    // Persists the units listed in dirtyUnits. Called from a single writer thread at a
+    // time, after load(); units is a private copy taken by the caller.
+    bool write(const QVector<Unit>& units, const QSet<int>& dirtyUnits);
+
+    // Human-readable export of the same data
+    static bool exportJson(const QVector<Unit>& units, const QString& jsonPath);
+
+private:
+    QString filePath;
+    QVector<QPair<qint64, quint32>> table; // Record offset and size per unit, as on disk
+    qint64 fileBytes;
+
+    bool writeFull(const QVector<Unit>& units);
+};
+
+#endif // MODELSNAPSHOT_H
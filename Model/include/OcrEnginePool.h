@@ -0,0 +1,59 @@
+#ifndef OCRENGINEPOOL_H
+#define OCRENGINEPOOL_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QFuture>
+#include <QThreadPool>
+#include <QMutex>
+#include <QWaitCondition>
+#include <tesseract/baseapi.h>
+#include "OcrPreprocessor.h"
+#include "OcrScanner.h"
+
+// A fixed set of initialised Tesseract engines, one per worker thread, so several
+// pages can be recognised at once. TessBaseAPI is not thread-safe, so each task
+// borrows an engine exclusively for the duration of one page.
+class OcrEnginePool {
+public:
+    // engineCount <= 0 uses one engine per CPU core
+    explicit OcrEnginePool(int engineCount = 0);
+    ~OcrEnginePool();
+
+    OcrEnginePool(const OcrEnginePool&) = delete;
+    OcrEnginePool& operator=(const OcrEnginePool&) = delete;
+
+    int engineCount() const;
+
+    // Recognises one image on the pool
+    QFuture<QString> scanImage(const QString &filePath);
+
+    // Recognises a batch of images in parallel. Results are in the same order as filePaths;
+    // the future reports progress per finished page and can be cancelled between pages.
+    QFuture<QString> scanImages(const QStringList &filePaths);
+
+    // Detects the text lines of one page, then recognises the lines in parallel across
+    // the engines. Lines come back in reading order with their boxes and confidences.
+    QFuture<QVector<OcrLine>> scanLines(const QString &filePath);
+
+    // Blocks until every queued page has been recognised
+    void waitForDone();
+
+    // Leptonica stages applied to every page; set before queueing work
+    void setPreprocessOptions(const OcrPreprocessOptions &options);
+
+private:
+    QThreadPool threadPool;
+    QVector<tesseract::TessBaseAPI*> engines;
+    QVector<tesseract::TessBaseAPI*> idleEngines;
+    QMutex mutex;
+    QWaitCondition engineReleased;
+    OcrPreprocessor preprocessor;
+
+    QString recognizeWithPooledEngine(const QString &filePath);
+    tesseract::TessBaseAPI *acquireEngine();
+    void releaseEngine(tesseract::TessBaseAPI *engine);
+};
+
+#endif // OCRENGINEPOOL_H
@@ -0,0 +1,52 @@
+#ifndef OCRPREPROCESSOR_H
+#define OCRPREPROCESSOR_H
+
+#include <QString>
+#include <leptonica/allheaders.h>
+
+// Which Leptonica stages run before an image is handed to Tesseract
+struct OcrPreprocessOptions {
+    bool enabled = true;
+    bool grayscale = true;     // Any depth -> 8 bpp luminance
+    bool downscale = true;     // Normalise resolution to targetDpi
+    bool binarize = true;      // Sauvola adaptive threshold -> 1 bpp
+    bool deskew = true;        // Straighten slightly rotated photos
+
+    int targetDpi = 300;       // Resolution Tesseract is tuned for
+    int maxLongSide = 3300;    // Fallback cap when the file has no usable DPI (A4 long side at 300 DPI)
+    int sauvolaHalfWindow = 12;
+    float sauvolaFactor = 0.34f;
+};
+
+// Wall-clock time spent in each stage, in microseconds
+struct OcrPreprocessTimings {
+    qint64 grayscaleUs = 0;
+    qint64 downscaleUs = 0;
+    qint64 binarizeUs = 0;
+    qint64 deskewUs = 0;
+    qint64 totalUs = 0;
+
+    QString toString() const;
+};
+
+// Turns a raw photo into the small 1 bpp image Tesseract actually needs.
+// Stages run as: grayscale, downscale, threshold, deskew. Downscaling the 8 bpp
+// image before thresholding keeps the threshold cheap and avoids the artefacts
+// of scaling a binary image.
+class OcrPreprocessor {
+public:
+    explicit OcrPreprocessor(const OcrPreprocessOptions &options = OcrPreprocessOptions());
+
+    const OcrPreprocessOptions &options() const { return opts; }
+
+    // Returns a new image the caller must pixDestroy(). source is left untouched.
+    // The result's resolution is set so it can be passed to SetSourceResolution.
+    Pix *process(Pix *source, OcrPreprocessTimings *timings = nullptr) const;
+
+private:
+    OcrPreprocessOptions opts;
+
+    float scaleFactorFor(Pix *image) const;
+};
+
+#endif // OCRPREPROCESSOR_H
@@ -0,0 +1,69 @@
+#ifndef OCRRESULT_H
+#define OCRRESULT_H
+
+#include <QRect>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// One recognised text line, in reading order
+struct OcrLine {
+    QRect box;               // Position in the preprocessed page, in pixels
+    QString text;
+    float confidence = 0.0f; // Tesseract's mean word confidence, 0-100
+};
+
+// Outcome of recognising one image: the text, or why there is none. Kept apart from
+// OcrScanner.h so the View can hold results without pulling in the Tesseract headers.
+struct OcrResult {
+    QString text;
+    QVector<OcrLine> lines;   // Reading order; empty when the page was recognised as one block
+    QString error;            // Empty on success, e.g. "No text detected in image"
+    bool cancelled = false;   // Stopped through OcrProgress before it finished
+
+    static OcrResult success(const QString &text)
+    {
+        OcrResult result;
+        result.text = text;
+        return result;
+    }
+
+    static OcrResult failure(const QString &error)
+    {
+        OcrResult result;
+        result.error = error;
+        return result;
+    }
+
+    static OcrResult cancellation()
+    {
+        OcrResult result = failure("Scan cancelled");
+        result.cancelled = true;
+        return result;
+    }
+
+    bool ok() const { return error.isEmpty(); }
+
+    // The solution steps, top to bottom: the recognised lines, or the non-empty lines of text
+    QStringList steps() const
+    {
+        QStringList result;
+        if (lines.isEmpty()) {
+            for (const QString &line : text.split('\n', Qt::SkipEmptyParts)) {
+                if (!line.trimmed().isEmpty()) {
+                    result.append(line.trimmed());
+                }
+            }
+        } else {
+            for (const OcrLine &line : lines) {
+                result.append(line.text);
+            }
+        }
+        return result;
+    }
+
+    // The text, or the "OCR Error: ..." string the synchronous scan API returns
+    QString textOrError() const { return ok() ? text : "OCR Error: " + error; }
+};
+
+#endif // OCRRESULT_H
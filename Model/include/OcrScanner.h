@@ -2,21 +2,82 @@
 #define OCRSCANNER_H
 
 #include <QString>
+#include <QFuture>
+#include <QMutex>
+#include <QRect>
+#include <QThreadPool>
+#include <QVector>
+#include <functional>
 #include <tesseract/baseapi.h>
 #include <leptonica/allheaders.h>
+#include "OcrPreprocessor.h"
+#include "OcrResult.h"
+
+// Progress and cancellation hooks for one recognition; both are called on the OCR thread
+struct OcrProgress {
+    std::function<void(int percent)> report;  // 0-100
+    std::function<bool()> cancelled;          // true stops recognition as soon as Tesseract checks
+};
 
 class OcrScanner {
 public:
     OcrScanner();
     ~OcrScanner();
 
+    // Starts loading the Tesseract model on a background thread. Safe to call more than
+    // once; scanImage() calls it itself if nobody warmed the scanner up beforehand.
+    void warmUp();
+    bool isReady() const;
+
+    // The recognised text, or "OCR Error: <reason>"
     QString scanImage(const QString &filePath);
 
+    // Recognises on a background thread so the caller's event loop keeps running. Works line by
+    // line like scanLines(), so the result keeps the solution steps in order; a page on which
+    // layout analysis finds no lines is recognised as one block instead. The future reports
+    // progress (0-100) and can be cancelled; a cancelled scan finishes without a result.
+    // Call from the thread that owns the scanner.
+    QFuture<OcrResult> scanImageAsync(const QString &filePath);
+
+    // Finds the text lines once, then recognises each as a single line (PSM_SINGLE_LINE)
+    // instead of running full-page layout analysis. Student work is a few short equations,
+    // so this is faster and keeps the solution steps in order.
+    QVector<OcrLine> scanLines(const QString &filePath);
+    static QString joinLines(const QVector<OcrLine> &lines);
+
+    // Leptonica stages applied to every image before recognition
+    void setPreprocessOptions(const OcrPreprocessOptions &options);
+
     // Getter function for external use
     QString getTextFromImage(const QString &filePath);
 
+    // Shared helpers so every engine (this scanner or an OcrEnginePool) behaves the same
+    static bool initializeEngine(tesseract::TessBaseAPI *engine);
+    // Returns OcrResult::cancellation() if progress->cancelled() stopped it
+    static OcrResult recognize(tesseract::TessBaseAPI *engine, const QString &filePath,
+                               const OcrPreprocessor &preprocessor = OcrPreprocessor(),
+                               const OcrProgress *progress = nullptr);
+
+    // Line-mode building blocks, shared with OcrEnginePool's parallel line recognition
+    static Pix *loadPage(const QString &filePath, const OcrPreprocessor &preprocessor); // Caller pixDestroy()s
+    static QVector<QRect> detectLines(tesseract::TessBaseAPI *engine, Pix *page);
+    static void setLineImage(tesseract::TessBaseAPI *engine, Pix *image);
+    static OcrLine recognizeLine(tesseract::TessBaseAPI *engine, const QRect &box); // Needs setLineImage() first
+    // Every box of page in order, skipping empty lines; stops early if progress is cancelled
+    static QVector<OcrLine> recognizeLines(tesseract::TessBaseAPI *engine, Pix *page, const QVector<QRect> &boxes,
+                                           const OcrProgress *progress = nullptr);
+
+    // tessdata directory containing eng.traineddata, resolved once per process and
+    // remembered between runs. Empty if none was found (Tesseract's default is used).
+    static QString tessdataPath();
+
 private:
-    tesseract::TessBaseAPI *tess;  // Make sure this exists
+    tesseract::TessBaseAPI *tess;  // Created by the warm-up task
+    QFuture<bool> ready;           // Finishes once tess is initialised
+    bool warmUpStarted;
+    OcrPreprocessor preprocessor;
+    QMutex engineMutex;            // tess serves one page at a time, sync or async
+    QThreadPool scanThread;        // Runs scanImageAsync() jobs, one at a time
 };
 
 #endif // OCRSCANNER_H
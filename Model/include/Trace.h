@@ -0,0 +1,113 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+// Span tracing for the hot paths (select -> generate -> display, grading, OCR).
+//
+// Built only when PIPINO_TRACING is 1 (cmake -DPIPINO_ENABLE_TRACING=ON); otherwise every
+// PIPINO_TRACE_* macro expands to nothing and Trace.cpp compiles to an empty object.
+// In a tracing build, recording additionally has to be switched on at run time with
+// Trace::setEnabled() (main.cpp does so when PIPINO_TRACE names an output file); while it
+// is off a span costs one relaxed atomic load.
+//
+// Each thread records into its own fixed-size ring buffer with no locking, so spans can
+// sit in the OCR workers as well as on the GUI thread. When a ring is full the oldest
+// spans are overwritten. A thread's ring is recycled for a new thread once it exits, so
+// memory stays bounded by the peak number of recording threads, not by how many came and went. Export at a quiet moment (e.g. on quit): a span written while
+// the buffers are being exported may come out torn.
+//
+// Category and name must be string literals; only the pointers are stored.
+
+#ifndef PIPINO_TRACING
+#define PIPINO_TRACING 0
+#endif
+
+#if PIPINO_TRACING
+
+namespace Trace {
+
+// Nanoseconds on a monotonic clock since the process started tracing
+qint64 now();
+
+bool isEnabled();
+void setEnabled(bool enabled);
+
+// Label for the calling thread in the exported trace ("GUI", "OCR worker", ...)
+void setThreadName(const char *name);
+
+// A finished span of durationNs ending now
+void recordElapsed(const char *category, const char *name, qint64 durationNs);
+void recordSpan(const char *category, const char *name, qint64 startNs, qint64 endNs);
+void recordCounter(const char *category, const char *name, qint64 value);
+
+class Scope
+{
+public:
+    Scope(const char *category, const char *name)
+        : category(category), name(name), startNs(isEnabled() ? now() : -1) {}
+    ~Scope()
+    {
+        if (startNs >= 0) {
+            recordSpan(category, name, startNs, now());
+        }
+    }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+private:
+    const char *category;
+    const char *name;
+    qint64 startNs;
+};
+
+// Per-name aggregate over everything currently held in the ring buffers
+struct SpanStats {
+    QString name;
+    int count = 0;
+    double totalMs = 0.0;
+    double maxMs = 0.0;
+    double meanMs() const { return count > 0 ? totalMs / count : 0.0; }
+};
+QVector<SpanStats> summarize();
+
+// Writes the buffered spans as Chrome trace JSON (chrome://tracing, Perfetto)
+bool exportChromeJson(const QString &filePath);
+
+// Drops every buffered span
+void clear();
+
+} // namespace Trace
+
+#define PIPINO_TRACE_CONCAT_INNER(a, b) a##b
+#define PIPINO_TRACE_CONCAT(a, b) PIPINO_TRACE_CONCAT_INNER(a, b)
+
+// Times the rest of the enclosing block
+#define PIPINO_TRACE_SCOPE(category, name) \
+    Trace::Scope PIPINO_TRACE_CONCAT(pipinoTraceScope, __LINE__)(category, name)
+
+// Records a span that ends now and lasted durationNs, for work that started in an
+// earlier callback (network requests, queued jobs)
+#define PIPINO_TRACE_ELAPSED(category, name, durationNs) \
+    do { if (Trace::isEnabled()) Trace::recordElapsed(category, name, durationNs); } while (0)
+
+#define PIPINO_TRACE_COUNTER(category, name, value) \
+    do { if (Trace::isEnabled()) Trace::recordCounter(category, name, value); } while (0)
+
+// Only takes effect while recording, so idle threads never allocate a ring buffer
+#define PIPINO_TRACE_THREAD_NAME(name) \
+    do { if (Trace::isEnabled()) Trace::setThreadName(name); } while (0)
+
+#else
+
+#define PIPINO_TRACE_SCOPE(category, name) do {} while (0)
+#define PIPINO_TRACE_ELAPSED(category, name, durationNs) do {} while (0)
+#define PIPINO_TRACE_COUNTER(category, name, value) do {} while (0)
+#define PIPINO_TRACE_THREAD_NAME(name) do {} while (0)
+
+#endif // PIPINO_TRACING
+
+#endif // TRACE_H
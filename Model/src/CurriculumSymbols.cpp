@@ -0,0 +1,82 @@
+#include "CurriculumSymbols.h"
+
+namespace {
+const QString& nameAt(int index)
+{
+    static const QString names[kDifficultyCount] = {
+        QStringLiteral("Easy"),
+        QStringLiteral("Medium"),
+        QStringLiteral("Hard")
+    };
+    return names[index];
+}
+}
+
+const QString& difficultyName(Difficulty difficulty)
+{
+    return nameAt(int(difficulty));
+}
+
+Difficulty difficultyFromString(QStringView text, Difficulty fallback)
+{
+    text = text.trimmed();
+    for (int i = 0; i < kDifficultyCount; ++i) {
+        if (text.compare(nameAt(i), Qt::CaseInsensitive) == 0) {
+            return Difficulty(i);
+        }
+    }
+    return fallback;
+}
+
+bool isDifficultyName(QStringView text)
+{
+    text = text.trimmed();
+    for (int i = 0; i < kDifficultyCount; ++i) {
+        if (text.compare(nameAt(i), Qt::CaseInsensitive) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+TopicTable& TopicTable::instance()
+{
+    static TopicTable table;
+    return table;
+}
+
+TopicId TopicTable::intern(const QString& name)
+{
+    {
+        QReadLocker reader(&lock);
+        auto it = ids.constFind(name);
+        if (it != ids.constEnd()) {
+            return it.value();
+        }
+    }
+
+    QWriteLocker writer(&lock);
+    auto it = ids.constFind(name);
+    if (it != ids.constEnd()) {
+        return it.value(); // Interned by another thread in between
+    }
+    names.append(name);
+    TopicId id = TopicId(names.size());
+    ids.insert(name, id);
+    return id;
+}
+
+QString TopicTable::name(TopicId id) const
+{
+    QReadLocker reader(&lock);
+    if (id == 0 || id > TopicId(names.size())) {
+        return QString();
+    }
+    return names[id - 1];
+}
+
+int TopicTable::size() const
+{
+    QReadLocker reader(&lock);
+    return names.size();
+}
@@ -1,26 +1,142 @@
 #include "Model.h"
+#include "OcrEnginePool.h"
+#include "ModelSnapshot.h"
+#include "Trace.h"
 #include <QDebug>
+#include <QtConcurrent/QtConcurrent>
+
+namespace {
+// Quiet period after the last edit before changed units are written out
+constexpr int kSnapshotDebounceMs = 2000;
+}
 
 Model::Model(QObject *parent)
-    : QObject(parent), currentUnitIndex(-1), currentProblemIndex(-1), userDifficultySetting("Medium")
+    : QObject(parent), currentUnitIndex(-1), currentProblemIndex(-1), userDifficultySetting(Difficulty::Medium)
+    , nextProblemId(1)
+    , snapshot(std::make_unique<ModelSnapshot>(ModelSnapshot::defaultPath()))
 {
-    initializeSampleData();
+    snapshotWriter.setMaxThreadCount(1);
+    snapshotTimer.setSingleShot(true);
+    snapshotTimer.setInterval(kSnapshotDebounceMs);
+    connect(&snapshotTimer, &QTimer::timeout, this, &Model::saveSnapshot);
+    
+    // Only a missing or unreadable snapshot falls back to the built-in curriculum
+    bool restored = snapshot->load(units);
+    if (!restored) {
+        initializeSampleData();
+    }
+    
+    // IDs restored from the snapshot stay as they are; new ones continue after the highest
+    for (const Unit& unit : std::as_const(units)) {
+        for (const Problem& problem : unit.problems) {
+            nextProblemId = qMax(nextProblemId, problem.id + 1);
+            if (problem.id != 0 && !problem.problemStatement.isEmpty()) {
+                restoredContent.insert(problem.id);
+            }
+        }
+    }
+    bool assigned = false;
+    for (int i = 0; i < units.size(); ++i) {
+        assigned |= assignProblemIds(units[i]);
+        indexUnit(i);
+    }
+    
+    if (!restored || assigned) {
+        markAllUnitsDirty();
+    }
+}
+
+Model::~Model()
+{
+    snapshotTimer.stop();
+    saveSnapshot();
+    snapshotWriter.waitForDone();
 }
 
 void Model::addUnit(const Unit& unit)
 {
     units.append(unit);
+    assignProblemIds(units.last());
+    indexUnit(units.size() - 1);
+    markAllUnitsDirty();
     emit unitsChanged();
 }
 
 void Model::removeUnit(int index)
 {
     if (index >= 0 && index < units.size()) {
+        for (const Problem& problem : units[index].problems) {
+            problemSlots.remove(problem.id);
+        }
         units.removeAt(index);
+        
+        // Every later unit moved down by one
+        for (int i = index; i < units.size(); ++i) {
+            indexUnit(i);
+        }
+        markAllUnitsDirty();
         emit unitsChanged();
     }
 }
 
+void Model::markUnitDirty(int unitIndex)
+{
+    dirtyUnits.insert(unitIndex);
+    snapshotTimer.start();
+}
+
+void Model::markAllUnitsDirty()
+{
+    // Indices shift when units are added or removed, so the whole list is rewritten
+    for (int i = 0; i < units.size(); ++i) {
+        dirtyUnits.insert(i);
+    }
+    snapshotTimer.start();
+}
+
+void Model::saveSnapshot()
+{
+    if (dirtyUnits.isEmpty()) {
+        return;
+    }
+    PIPINO_TRACE_SCOPE("model", "Model::saveSnapshot");
+    
+    // The copy is shallow; the GUI thread detaches from it on its next edit
+    QVector<Unit> unitsCopy = persistentUnits();
+    QSet<int> changed = std::move(dirtyUnits);
+    dirtyUnits.clear();
+    
+    ModelSnapshot* target = snapshot.get();
+    QtConcurrent::run(&snapshotWriter, [target, unitsCopy, changed]() {
+        PIPINO_TRACE_THREAD_NAME("Snapshot writer");
+        PIPINO_TRACE_SCOPE("model", "ModelSnapshot::write");
+        if (!target->write(unitsCopy, changed)) {
+            qWarning() << "Model: failed to save curriculum snapshot to" << target->path();
+        }
+    });
+}
+
+bool Model::exportJson(const QString& jsonPath) const
+{
+    return ModelSnapshot::exportJson(persistentUnits(), jsonPath);
+}
+
+QVector<Unit> Model::persistentUnits() const
+{
+    QVector<Unit> result = units;
+    for (auto it = placeholderContent.constBegin(); it != placeholderContent.constEnd(); ++it) {
+        int unitIndex = -1;
+        int problemIndex = -1;
+        if (locateProblem(it.key(), unitIndex, problemIndex)) {
+            Problem& problem = result[unitIndex].problems[problemIndex];
+            problem.problemStatement = it->problemStatement;
+            problem.choices = it->choices;
+            problem.correctChoiceIndex = it->correctChoiceIndex;
+        }
+    }
+    return result;
+}
+
 const QVector<Unit>& Model::getUnits() const
 {
     return units;
@@ -34,6 +150,77 @@ Unit* Model::getUnit(int index)
     return nullptr;
 }
 
+const Unit* Model::getUnit(int index) const
+{
+    if (index >= 0 && index < units.size()) {
+        return &units[index];
+    }
+    return nullptr;
+}
+
+ProblemId Model::problemId(int unitIndex, int problemIndex) const
+{
+    const Problem* problem = problemAt(unitIndex, problemIndex);
+    return problem ? problem->id : 0;
+}
+
+const Problem* Model::findProblem(ProblemId id) const
+{
+    auto it = problemSlots.constFind(id);
+    if (it == problemSlots.constEnd()) {
+        return nullptr;
+    }
+    return &units[it->unitIndex].problems[it->problemIndex];
+}
+
+bool Model::locateProblem(ProblemId id, int& unitIndex, int& problemIndex) const
+{
+    auto it = problemSlots.constFind(id);
+    if (it == problemSlots.constEnd()) {
+        return false;
+    }
+    unitIndex = it->unitIndex;
+    problemIndex = it->problemIndex;
+    return true;
+}
+
+const Problem* Model::problemAt(int unitIndex, int problemIndex) const
+{
+    if (unitIndex >= 0 && unitIndex < units.size()) {
+        const Unit& unit = units[unitIndex];
+        if (problemIndex >= 0 && problemIndex < unit.problems.size()) {
+            return &unit.problems[problemIndex];
+        }
+    }
+    return nullptr;
+}
+
+bool Model::assignProblemIds(Unit& unit)
+{
+    bool assigned = false;
+    TopicTable& topics = TopicTable::instance();
+    for (Problem& problem : unit.problems) {
+        if (problem.id == 0 || problemSlots.contains(problem.id)) {
+            problem.id = nextProblemId++;
+            assigned = true;
+        }
+        problem.correctChoiceIndex = findCorrectChoice(problem.choices);
+        
+        // Problems sharing a name also share the interned string
+        problem.topic = topics.intern(problem.name);
+        problem.name = topics.name(problem.topic);
+    }
+    return assigned;
+}
+
+void Model::indexUnit(int unitIndex)
+{
+    const QVector<Problem>& problems = units[unitIndex].problems;
+    for (int i = 0; i < problems.size(); ++i) {
+        problemSlots.insert(problems[i].id, ProblemSlot{unitIndex, i});
+    }
+}
+
 int Model::getUnitCount() const
 {
     return units.size();
@@ -42,7 +229,16 @@ int Model::getUnitCount() const
 void Model::addProblemToUnit(int unitIndex, const Problem& problem)
 {
     if (unitIndex >= 0 && unitIndex < units.size()) {
-        units[unitIndex].addProblem(problem);
+        Problem added = problem;
+        if (added.id == 0 || problemSlots.contains(added.id)) {
+            added.id = nextProblemId++;
+        }
+        added.topic = TopicTable::instance().intern(added.name);
+        added.name = TopicTable::instance().name(added.topic);
+        added.correctChoiceIndex = findCorrectChoice(added.choices);
+        units[unitIndex].addProblem(added);
+        problemSlots.insert(added.id, ProblemSlot{unitIndex, int(units[unitIndex].problems.size()) - 1});
+        markUnitDirty(unitIndex);
         emit unitProblemsChanged(unitIndex);
     }
 }
@@ -51,7 +247,12 @@ void Model::removeProblemFromUnit(int unitIndex, int problemIndex)
 {
     if (unitIndex >= 0 && unitIndex < units.size()) {
         if (problemIndex >= 0 && problemIndex < units[unitIndex].problems.size()) {
+            problemSlots.remove(units[unitIndex].problems[problemIndex].id);
+            placeholderContent.remove(units[unitIndex].problems[problemIndex].id);
+            restoredContent.remove(units[unitIndex].problems[problemIndex].id);
             units[unitIndex].problems.removeAt(problemIndex);
+            indexUnit(unitIndex);
+            markUnitDirty(unitIndex);
             emit unitProblemsChanged(unitIndex);
         }
     }
@@ -72,31 +273,31 @@ void Model::initializeSampleData()
 {
     // Unit 1: Basic Mathematics
     Unit mathUnit("Basic Mathematics", "Fundamental mathematical concepts and operations");
-    mathUnit.addProblem(Problem("Addition & Subtraction", "Basic arithmetic operations", "Easy"));
-    mathUnit.addProblem(Problem("Multiplication & Division", "Basic multiplication and division", "Easy"));
-    mathUnit.addProblem(Problem("Fractions", "Working with fractions and decimals", "Medium"));
-    mathUnit.addProblem(Problem("Percentages", "Calculating percentages and ratios", "Medium"));
+    mathUnit.addProblem(Problem("Addition & Subtraction", "Basic arithmetic operations", Difficulty::Easy));
+    mathUnit.addProblem(Problem("Multiplication & Division", "Basic multiplication and division", Difficulty::Easy));
+    mathUnit.addProblem(Problem("Fractions", "Working with fractions and decimals", Difficulty::Medium));
+    mathUnit.addProblem(Problem("Percentages", "Calculating percentages and ratios", Difficulty::Medium));
     
     // Unit 2: Algebra
     Unit algebraUnit("Algebra", "Introduction to algebraic concepts");
-    algebraUnit.addProblem(Problem("Linear Equations", "Solving linear equations", "Medium"));
-    algebraUnit.addProblem(Problem("Quadratic Equations", "Solving quadratic equations", "Hard"));
-    algebraUnit.addProblem(Problem("Systems of Equations", "Solving systems of linear equations", "Hard"));
-    algebraUnit.addProblem(Problem("Polynomials", "Working with polynomial expressions", "Medium"));
+    algebraUnit.addProblem(Problem("Linear Equations", "Solving linear equations", Difficulty::Medium));
+    algebraUnit.addProblem(Problem("Quadratic Equations", "Solving quadratic equations", Difficulty::Hard));
+    algebraUnit.addProblem(Problem("Systems of Equations", "Solving systems of linear equations", Difficulty::Hard));
+    algebraUnit.addProblem(Problem("Polynomials", "Working with polynomial expressions", Difficulty::Medium));
     
     // Unit 3: Geometry
     Unit geometryUnit("Geometry", "Basic geometric shapes and calculations");
-    geometryUnit.addProblem(Problem("Area & Perimeter", "Calculating area and perimeter", "Easy"));
-    geometryUnit.addProblem(Problem("Triangles", "Properties and calculations of triangles", "Medium"));
-    geometryUnit.addProblem(Problem("Circles", "Circle properties and calculations", "Medium"));
-    geometryUnit.addProblem(Problem("3D Shapes", "Volume and surface area of 3D shapes", "Hard"));
+    geometryUnit.addProblem(Problem("Area & Perimeter", "Calculating area and perimeter", Difficulty::Easy));
+    geometryUnit.addProblem(Problem("Triangles", "Properties and calculations of triangles", Difficulty::Medium));
+    geometryUnit.addProblem(Problem("Circles", "Circle properties and calculations", Difficulty::Medium));
+    geometryUnit.addProblem(Problem("3D Shapes", "Volume and surface area of 3D shapes", Difficulty::Hard));
     
     // Unit 4: Statistics
     Unit statsUnit("Statistics", "Basic statistical concepts and data analysis");
-    statsUnit.addProblem(Problem("Mean, Median, Mode", "Measures of central tendency", "Easy"));
-    statsUnit.addProblem(Problem("Standard Deviation", "Measuring data spread", "Medium"));
-    statsUnit.addProblem(Problem("Probability", "Basic probability calculations", "Medium"));
-    statsUnit.addProblem(Problem("Data Visualization", "Creating and interpreting graphs", "Easy"));
+    statsUnit.addProblem(Problem("Mean, Median, Mode", "Measures of central tendency", Difficulty::Easy));
+    statsUnit.addProblem(Problem("Standard Deviation", "Measuring data spread", Difficulty::Medium));
+    statsUnit.addProblem(Problem("Probability", "Basic probability calculations", Difficulty::Medium));
+    statsUnit.addProblem(Problem("Data Visualization", "Creating and interpreting graphs", Difficulty::Easy));
     
     units.append(mathUnit);
     units.append(algebraUnit);
@@ -106,12 +307,8 @@ void Model::initializeSampleData()
 
 QString Model::getProblemStatement(int unitIndex, int problemIndex) const
 {
-    if (unitIndex >= 0 && unitIndex < units.size()) {
-        const Unit& unit = units[unitIndex];
-        if (problemIndex >= 0 && problemIndex < unit.problems.size()) {
-            const Problem& problem = unit.problems[problemIndex];
-            return problem.problemStatement;
-        }
+    if (const Problem* problem = problemAt(unitIndex, problemIndex)) {
+        return problem->problemStatement;
     }
     return "Problem not found";
 }
@@ -127,35 +324,61 @@ QString Model::getTheoryContent(int unitIndex, int problemIndex) const
             }
             // Generic fallback for theory (AI doesn't generate theory yet)
             return QString("Theory for %1\n\n%2\n\nThis is a %3 level topic in %4.")
-                   .arg(problem.name, problem.description, problem.difficulty, unit.name);
+                   .arg(problem.name, problem.description, difficultyName(problem.difficulty), unit.name);
         }
     }
     return "Theory content not found";
 }
 
-QVector<MultipleChoiceOption> Model::getMultipleChoiceOptions(int unitIndex, int problemIndex) const
+const QVector<MultipleChoiceOption>& Model::getMultipleChoiceOptions(int unitIndex, int problemIndex) const
 {
-    if (unitIndex >= 0 && unitIndex < units.size()) {
-        const Unit& unit = units[unitIndex];
-        if (problemIndex >= 0 && problemIndex < unit.problems.size()) {
-            const Problem& problem = unit.problems[problemIndex];
-            return problem.choices;
-        }
+    if (const Problem* problem = problemAt(unitIndex, problemIndex)) {
+        return problem->choices;
     }
     
-    // Return empty if not found - AI should always populate this
-    return QVector<MultipleChoiceOption>();
+    // Empty if not found - AI should always populate this
+    static const QVector<MultipleChoiceOption> noChoices;
+    return noChoices;
 }
 
 int Model::getCorrectChoiceIndex(int unitIndex, int problemIndex) const
 {
-    QVector<MultipleChoiceOption> choices = getMultipleChoiceOptions(unitIndex, problemIndex);
+    const Problem* problem = problemAt(unitIndex, problemIndex);
+    if (problem && problem->correctChoiceIndex >= 0) {
+        return problem->correctChoiceIndex;
+    }
+    return 1; // Default to option B if no correct answer found
+}
+
+ProblemView Model::problemView(int unitIndex, int problemIndex) const
+{
+    ProblemView view;
+    const Problem* problem = problemAt(unitIndex, problemIndex);
+    if (!problem) {
+        return view;
+    }
+    
+    view.valid = true;
+    view.id = problem->id;
+    view.unitName = units[unitIndex].name;
+    view.problemName = problem->name;
+    view.statement = problem->problemStatement;
+    view.hasContent = !view.statement.isEmpty() && !placeholderContent.contains(problem->id);
+    view.choices = problem->choices;
+    if (problem->correctChoiceIndex >= 0) {
+        view.correctChoiceIndex = problem->correctChoiceIndex;
+    }
+    return view;
+}
+
+int Model::findCorrectChoice(const QVector<MultipleChoiceOption>& choices)
+{
     for (int i = 0; i < choices.size(); ++i) {
         if (choices[i].isCorrect) {
             return i;
         }
     }
-    return 1; // Default to option B if no correct answer found
+    return -1;
 }
 
 QString Model::unitProblemToString(int unitIndex, int problemIndex) const
@@ -199,7 +422,7 @@ std::string Model::getCurrentProblem() const
 std::string Model::getCurrentDifficulty() const
 {
     // Return the USER'S difficulty setting (from settings), not the problem's hardcoded difficulty
-    return qStringToStdString(userDifficultySetting);
+    return qStringToStdString(difficultyName(userDifficultySetting));
 }
 
 bool Model::isCurrentProblemMultipleChoice() const
@@ -232,39 +455,110 @@ void Model::setCurrentSelection(int unitIndex, int problemIndex)
 }
 
 // User settings methods implementation
-void Model::setUserDifficulty(const QString& difficulty)
+void Model::setUserDifficulty(Difficulty difficulty)
 {
-    // Validate the difficulty setting
-    if (difficulty == "Easy" || difficulty == "Medium" || difficulty == "Hard") {
+    if (difficulty != userDifficultySetting) {
         userDifficultySetting = difficulty;
-    } else {
-        // Invalid difficulty - default to Medium
-        userDifficultySetting = "Medium";
+        emit userDifficultyChanged(userDifficultySetting);
     }
 }
 
-QString Model::getUserDifficulty() const
+void Model::setUserDifficulty(const QString& difficulty)
+{
+    // Invalid difficulty - default to Medium
+    setUserDifficulty(difficultyFromString(difficulty, Difficulty::Medium));
+}
+
+Difficulty Model::userDifficulty() const
 {
     return userDifficultySetting;
 }
 
+QString Model::getUserDifficulty() const
+{
+    return difficultyName(userDifficultySetting);
+}
+
+void Model::warmUpOcr()
+{
+    ocrScanner.warmUp();
+}
+
 QString Model::scanImage(const QString& imagePath)
 {
     return ocrScanner.scanImage(imagePath);
 }
 
+QFuture<OcrResult> Model::scanImageAsync(const QString& imagePath)
+{
+    return ocrScanner.scanImageAsync(imagePath);
+}
+
+QFuture<QString> Model::scanImages(const QStringList& imagePaths)
+{
+    return ocrPool().scanImages(imagePaths);
+}
+
+OcrEnginePool& Model::ocrPool()
+{
+    if (!ocrEnginePool) {
+        ocrEnginePool = std::make_unique<OcrEnginePool>();
+    }
+    return *ocrEnginePool;
+}
+
 void Model::updateProblemContent(int unitIndex, int problemIndex, 
                                  const QString& problemStatement, 
-                                 const QVector<MultipleChoiceOption>& choices)
+                                 const QVector<MultipleChoiceOption>& choices,
+                                 bool persist)
 {
+    // Includes the views refreshed by problemContentChanged
+    PIPINO_TRACE_SCOPE("model", "Model::updateProblemContent");
+    
     // Validate indices
     if (unitIndex >= 0 && unitIndex < units.size() &&
         problemIndex >= 0 && problemIndex < units[unitIndex].problems.size()) {
         
+        Problem& problem = units[unitIndex].problems[problemIndex];
+        restoredContent.remove(problem.id);
+        if (persist) {
+            placeholderContent.remove(problem.id);
+        } else if (!placeholderContent.contains(problem.id)) {
+            // Remember what the snapshot should keep while the placeholder is shown
+            placeholderContent.insert(problem.id, PersistedContent{problem.problemStatement, problem.choices,
+                                                                   problem.correctChoiceIndex});
+        }
+        
         // Update the problem's statement and choices
-        units[unitIndex].problems[problemIndex].problemStatement = problemStatement;
-        units[unitIndex].problems[problemIndex].choices = choices;
+        problem.problemStatement = problemStatement;
+        problem.choices = choices;
+        
+        // Worked out once here instead of on every dialog refresh
+        problem.correctChoiceIndex = findCorrectChoice(choices);
+        if (persist) {
+            markUnitDirty(unitIndex);
+        }
         
         qDebug() << "Updated problem content for Unit" << unitIndex << "Problem" << problemIndex;
+        emit problemContentChanged(unitIndex, problemIndex);
     }
+}
+
+void Model::updateProblemContent(ProblemId id,
+                                 const QString& problemStatement,
+                                 const QVector<MultipleChoiceOption>& choices,
+                                 bool persist)
+{
+    int unitIndex = -1;
+    int problemIndex = -1;
+    if (locateProblem(id, unitIndex, problemIndex)) {
+        updateProblemContent(unitIndex, problemIndex, problemStatement, choices, persist);
+    } else {
+        qDebug() << "Dropped content for removed problem" << id;
+    }
+}
+
+bool Model::takeRestoredContent(ProblemId id)
+{
+    return restoredContent.remove(id);
 }
\ No newline at end of file
@@ -0,0 +1,303 @@
+#include "ModelSnapshot.h"
+#include "Model.h"
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtEndian>
+#include <algorithm>
+
+namespace {
+constexpr quint32 kSnapshotMagic = 0x4E534350; // "PCSN"
+constexpr int kHeaderSize = 4 + 4 + 4 + 4 + 8;
+constexpr int kTableEntrySize = 8 + 4;
+
+// Stale records are tolerated until they are most of the file and worth a rewrite
+constexpr qint64 kCompactionSlackBytes = 64 * 1024;
+
+QByteArray encodeHeader(quint32 unitCount, quint64 tableOffset)
+{
+    QByteArray header(kHeaderSize, Qt::Uninitialized);
+    char *p = header.data();
+    qToLittleEndian<quint32>(kSnapshotMagic, p);
+    qToLittleEndian<quint32>(ModelSnapshot::kFormatVersion, p + 4);
+    qToLittleEndian<quint32>(unitCount, p + 8);
+    qToLittleEndian<quint32>(0, p + 12);
+    qToLittleEndian<quint64>(tableOffset, p + 16);
+    return header;
+}
+
+QByteArray encodeTable(const QVector<QPair<qint64, quint32>>& table)
+{
+    QByteArray bytes(table.size() * kTableEntrySize, Qt::Uninitialized);
+    char *p = bytes.data();
+    for (const auto& entry : table) {
+        qToLittleEndian<quint64>(quint64(entry.first), p);
+        qToLittleEndian<quint32>(entry.second, p + 8);
+        p += kTableEntrySize;
+    }
+    return bytes;
+}
+
+QByteArray encodeUnit(const Unit& unit)
+{
+    QByteArray bytes;
+    QDataStream out(&bytes, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+
+    out << unit.name << unit.description << quint32(unit.problems.size());
+    for (const Problem& problem : unit.problems) {
+        out << problem.id << problem.name << problem.description << quint8(problem.difficulty)
+            << problem.problemStatement << problem.theoryContent << quint32(problem.choices.size());
+        for (const MultipleChoiceOption& choice : problem.choices) {
+            out << choice.text << choice.isCorrect;
+        }
+    }
+    return bytes;
+}
+
+// Version 1 records predate problem IDs; those problems get fresh IDs from the Model.
+// Before version 3 the difficulty was stored as its name.
+bool decodeUnit(const QByteArray& bytes, Unit& unit, quint32 version)
+{
+    QDataStream in(bytes);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 problemCount = 0;
+    in >> unit.name >> unit.description >> problemCount;
+    if (in.status() != QDataStream::Ok || problemCount > quint32(bytes.size())) {
+        return false;
+    }
+
+    unit.problems.resize(problemCount);
+    for (Problem& problem : unit.problems) {
+        quint32 choiceCount = 0;
+        if (version >= 2) {
+            in >> problem.id;
+        }
+        in >> problem.name >> problem.description;
+        if (version >= 3) {
+            quint8 difficulty = 0;
+            in >> difficulty;
+            problem.difficulty = Difficulty(qMin<int>(difficulty, kDifficultyCount - 1));
+        } else {
+            QString difficulty;
+            in >> difficulty;
+            problem.difficulty = difficultyFromString(difficulty, Difficulty::Easy);
+        }
+        in >> problem.problemStatement >> problem.theoryContent >> choiceCount;
+        if (in.status() != QDataStream::Ok || choiceCount > quint32(bytes.size())) {
+            return false;
+        }
+        problem.choices.resize(choiceCount);
+        for (MultipleChoiceOption& choice : problem.choices) {
+            in >> choice.text >> choice.isCorrect;
+        }
+    }
+    return in.status() == QDataStream::Ok;
+}
+}
+
+ModelSnapshot::ModelSnapshot(const QString& path)
+    : filePath(path)
+    , fileBytes(0)
+{
+}
+
+QString ModelSnapshot::defaultPath()
+{
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(dir);
+    return dir + "/curriculum.snapshot";
+}
+
+bool ModelSnapshot::load(QVector<Unit>& units)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly) || file.size() < kHeaderSize) {
+        return false;
+    }
+
+    const qint64 size = file.size();
+    const uchar *data = file.map(0, size);
+    QByteArray buffer;
+    if (!data) {
+        // Some file systems cannot be mapped; reading it is just slower
+        buffer = file.readAll();
+        data = reinterpret_cast<const uchar*>(buffer.constData());
+    }
+
+    quint32 magic = qFromLittleEndian<quint32>(data);
+    quint32 version = qFromLittleEndian<quint32>(data + 4);
+    quint32 unitCount = qFromLittleEndian<quint32>(data + 8);
+    quint64 tableOffset = qFromLittleEndian<quint64>(data + 16);
+
+    if (magic != kSnapshotMagic || version < 1 || version > kFormatVersion ||
+        tableOffset < quint64(kHeaderSize) ||
+        tableOffset + quint64(unitCount) * kTableEntrySize > quint64(size)) {
+        qWarning() << "ModelSnapshot: ignoring incompatible or damaged snapshot" << filePath;
+        return false;
+    }
+
+    QVector<Unit> loaded(unitCount);
+    QVector<QPair<qint64, quint32>> loadedTable(unitCount);
+    const uchar *entry = data + tableOffset;
+    for (quint32 i = 0; i < unitCount; ++i, entry += kTableEntrySize) {
+        quint64 offset = qFromLittleEndian<quint64>(entry);
+        quint32 recordSize = qFromLittleEndian<quint32>(entry + 8);
+        if (offset < quint64(kHeaderSize) || offset + recordSize > quint64(size)) {
+            return false;
+        }
+
+        // Decoded straight from the mapping; only the strings themselves are copied
+        QByteArray record = QByteArray::fromRawData(reinterpret_cast<const char*>(data + offset), recordSize);
+        if (!decodeUnit(record, loaded[i], version)) {
+            qWarning() << "ModelSnapshot: damaged record for unit" << i << "in" << filePath;
+            return false;
+        }
+        loadedTable[i] = qMakePair(qint64(offset), recordSize);
+    }
+
+    units = std::move(loaded);
+    table = std::move(loadedTable);
+    
+    // Records are never mixed across versions: an older file is rewritten in full on the next save
+    fileBytes = version == kFormatVersion ? size : 0;
+
+    qDebug() << "ModelSnapshot: loaded" << unitCount << "units in" << timer.elapsed() << "ms";
+    return true;
+}
+
+bool ModelSnapshot::write(const QVector<Unit>& units, const QSet<int>& dirtyUnits)
+{
+    if (table.size() != units.size() || fileBytes == 0 || !QFile::exists(filePath)) {
+        return writeFull(units);
+    }
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadWrite) || file.size() != fileBytes) {
+        return writeFull(units);
+    }
+
+    // New records and the new table go after everything the current header points at
+    QList<int> changed(dirtyUnits.begin(), dirtyUnits.end());
+    std::sort(changed.begin(), changed.end());
+
+    file.seek(fileBytes);
+    for (int index : std::as_const(changed)) {
+        if (index < 0 || index >= units.size()) {
+            continue;
+        }
+        QByteArray record = encodeUnit(units[index]);
+        qint64 offset = file.pos();
+        if (file.write(record) != record.size()) {
+            return false;
+        }
+        table[index] = qMakePair(offset, quint32(record.size()));
+    }
+
+    qint64 tableOffset = file.pos();
+    QByteArray tableBytes = encodeTable(table);
+    if (file.write(tableBytes) != tableBytes.size() || !file.flush()) {
+        return false;
+    }
+
+    // Repointing the header is the commit; until then the old table is still the valid one
+    file.seek(0);
+    QByteArray header = encodeHeader(quint32(units.size()), quint64(tableOffset));
+    if (file.write(header) != header.size() || !file.flush()) {
+        return false;
+    }
+    fileBytes = file.size();
+    file.close();
+
+    qint64 liveBytes = kHeaderSize + tableBytes.size();
+    for (const auto& entry : std::as_const(table)) {
+        liveBytes += entry.second;
+    }
+    if (fileBytes - liveBytes > kCompactionSlackBytes && fileBytes > 2 * liveBytes) {
+        return writeFull(units);
+    }
+    return true;
+}
+
+bool ModelSnapshot::writeFull(const QVector<Unit>& units)
+{
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "ModelSnapshot: cannot write" << filePath;
+        return false;
+    }
+
+    QVector<QByteArray> records;
+    records.reserve(units.size());
+    QVector<QPair<qint64, quint32>> newTable;
+    newTable.reserve(units.size());
+
+    qint64 offset = kHeaderSize;
+    for (const Unit& unit : units) {
+        records.append(encodeUnit(unit));
+        newTable.append(qMakePair(offset, quint32(records.last().size())));
+        offset += records.last().size();
+    }
+
+    file.write(encodeHeader(quint32(units.size()), quint64(offset)));
+    for (const QByteArray& record : std::as_const(records)) {
+        file.write(record);
+    }
+    file.write(encodeTable(newTable));
+
+    if (!file.commit()) {
+        qWarning() << "ModelSnapshot: failed to save" << filePath;
+        return false;
+    }
+
+    table = std::move(newTable);
+    fileBytes = offset + qint64(table.size()) * kTableEntrySize;
+    return true;
+}
+
+bool ModelSnapshot::exportJson(const QVector<Unit>& units, const QString& jsonPath)
+{
+    QJsonArray unitArray;
+    for (const Unit& unit : units) {
+        QJsonArray problemArray;
+        for (const Problem& problem : unit.problems) {
+            QJsonArray choiceArray;
+            for (const MultipleChoiceOption& choice : problem.choices) {
+                choiceArray.append(QJsonObject{{"text", choice.text}, {"isCorrect", choice.isCorrect}});
+            }
+            problemArray.append(QJsonObject{
+                {"name", problem.name},
+                {"description", problem.description},
+                {"difficulty", difficultyName(problem.difficulty)},
+                {"problemStatement", problem.problemStatement},
+                {"theoryContent", problem.theoryContent},
+                {"choices", choiceArray}
+            });
+        }
+        unitArray.append(QJsonObject{
+            {"name", unit.name},
+            {"description", unit.description},
+            {"problems", problemArray}
+        });
+    }
+
+    QJsonObject root{{"formatVersion", int(kFormatVersion)}, {"units", unitArray}};
+
+    QSaveFile file(jsonPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+    return file.commit();
+}
@@ -0,0 +1,172 @@
+#include "OcrEnginePool.h"
+#include "OcrScanner.h"
+#include "Trace.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QThread>
+#include <QtConcurrent/QtConcurrent>
+
+OcrEnginePool::OcrEnginePool(int engineCount)
+{
+    if (engineCount <= 0) {
+        engineCount = qMax(1, QThread::idealThreadCount());
+    }
+
+    // One worker thread per engine: a running task can always find an idle engine
+    threadPool.setMaxThreadCount(engineCount);
+
+    // Loading the language model dominates start-up, so initialise the engines in parallel
+    QElapsedTimer timer;
+    timer.start();
+
+    engines.resize(engineCount);
+    QVector<QFuture<void>> initializations;
+    for (int i = 0; i < engineCount; ++i) {
+        initializations.append(QtConcurrent::run(&threadPool, [this, i]() {
+            auto *engine = new tesseract::TessBaseAPI();
+            if (OcrScanner::initializeEngine(engine)) {
+                engines[i] = engine;
+            } else {
+                delete engine;
+            }
+        }));
+    }
+    for (auto &initialization : initializations) {
+        initialization.waitForFinished();
+    }
+
+    engines.removeAll(nullptr);
+    idleEngines = engines;
+
+    qDebug() << "OcrEnginePool: initialised" << engines.size() << "engines in" << timer.elapsed() << "ms";
+}
+
+OcrEnginePool::~OcrEnginePool()
+{
+    threadPool.clear();
+    threadPool.waitForDone();
+
+    for (tesseract::TessBaseAPI *engine : std::as_const(engines)) {
+        engine->End();
+        delete engine;
+    }
+}
+
+int OcrEnginePool::engineCount() const
+{
+    return engines.size();
+}
+
+QFuture<QString> OcrEnginePool::scanImage(const QString &filePath)
+{
+    return QtConcurrent::run(&threadPool, [this, filePath]() {
+        return recognizeWithPooledEngine(filePath);
+    });
+}
+
+QFuture<QString> OcrEnginePool::scanImages(const QStringList &filePaths)
+{
+    return QtConcurrent::mapped(&threadPool, filePaths, [this](const QString &filePath) {
+        return recognizeWithPooledEngine(filePath);
+    });
+}
+
+QFuture<QVector<OcrLine>> OcrEnginePool::scanLines(const QString &filePath)
+{
+    // The coordinating task blocks on the per-line work, so it runs on the global pool
+    // rather than occupying one of this pool's engine threads
+    return QtConcurrent::run([this, filePath]() -> QVector<OcrLine> {
+        Pix *page = OcrScanner::loadPage(filePath, preprocessor);
+        if (!page) {
+            return QVector<OcrLine>();
+        }
+
+        QVector<QRect> boxes;
+        if (tesseract::TessBaseAPI *engine = acquireEngine()) {
+            boxes = OcrScanner::detectLines(engine, page);
+            releaseEngine(engine);
+        }
+
+        // Each line gets its own cropped image, so no Pix is shared between engines
+        QFuture<OcrLine> recognized = QtConcurrent::mapped(&threadPool, boxes, [this, page](const QRect &box) {
+            OcrLine line;
+            BOX *clip = boxCreate(box.x(), box.y(), box.width(), box.height());
+            Pix *lineImage = pixClipRectangle(page, clip, nullptr);
+            boxDestroy(&clip);
+            if (!lineImage) {
+                line.box = box;
+                return line;
+            }
+
+            PIPINO_TRACE_THREAD_NAME("OCR worker");
+            tesseract::TessBaseAPI *engine = acquireEngine();
+            if (engine) {
+                OcrScanner::setLineImage(engine, lineImage);
+                line = OcrScanner::recognizeLine(engine, QRect(0, 0, box.width(), box.height()));
+                engine->Clear();
+                releaseEngine(engine);
+            }
+            pixDestroy(&lineImage);
+
+            line.box = box;
+            return line;
+        });
+
+        QVector<OcrLine> lines;
+        for (const OcrLine &line : recognized.results()) {
+            if (!line.text.isEmpty()) {
+                lines.append(line);
+            }
+        }
+
+        pixDestroy(&page);
+        return lines;
+    });
+}
+
+void OcrEnginePool::waitForDone()
+{
+    threadPool.waitForDone();
+}
+
+void OcrEnginePool::setPreprocessOptions(const OcrPreprocessOptions &options)
+{
+    preprocessor = OcrPreprocessor(options);
+}
+
+QString OcrEnginePool::recognizeWithPooledEngine(const QString &filePath)
+{
+    PIPINO_TRACE_THREAD_NAME("OCR worker");
+    tesseract::TessBaseAPI *engine = acquireEngine();
+    if (!engine) {
+        return OcrResult::failure("Tesseract not initialized").textOrError();
+    }
+
+    QString result = OcrScanner::recognize(engine, filePath, preprocessor).textOrError();
+    releaseEngine(engine);
+    return result;
+}
+
+tesseract::TessBaseAPI *OcrEnginePool::acquireEngine()
+{
+    PIPINO_TRACE_SCOPE("ocr", "OcrEnginePool::acquireEngine");
+    QMutexLocker locker(&mutex);
+
+    if (engines.isEmpty()) {
+        return nullptr;
+    }
+
+    // Only happens if fewer engines initialised than there are worker threads
+    while (idleEngines.isEmpty()) {
+        engineReleased.wait(&mutex);
+    }
+    return idleEngines.takeLast();
+}
+
+void OcrEnginePool::releaseEngine(tesseract::TessBaseAPI *engine)
+{
+    QMutexLocker locker(&mutex);
+    idleEngines.append(engine);
+    engineReleased.wakeOne();
+}
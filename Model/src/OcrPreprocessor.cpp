@@ -0,0 +1,110 @@
+#include "OcrPreprocessor.h"
+#include "Trace.h"
+#include <QElapsedTimer>
+#include <QDebug>
+
+namespace {
+// Replaces *current with next, dropping our reference to the previous intermediate image.
+// Leptonica stages may return a clone of their input (pixDeskew does for an upright page),
+// which is the same pointer with one more reference, so release it even when they match.
+void advance(Pix **current, Pix *next) {
+    if (next) {
+        pixDestroy(current);
+        *current = next;
+    }
+}
+
+qint64 elapsedUs(QElapsedTimer &timer) {
+    qint64 us = timer.nsecsElapsed() / 1000;
+    timer.restart();
+    return us;
+}
+}
+
+QString OcrPreprocessTimings::toString() const {
+    return QString("grayscale %1 us, downscale %2 us, binarize %3 us, deskew %4 us, total %5 us")
+           .arg(grayscaleUs).arg(downscaleUs).arg(binarizeUs).arg(deskewUs).arg(totalUs);
+}
+
+OcrPreprocessor::OcrPreprocessor(const OcrPreprocessOptions &options)
+    : opts(options) {
+}
+
+Pix *OcrPreprocessor::process(Pix *source, OcrPreprocessTimings *timings) const {
+    PIPINO_TRACE_SCOPE("ocr", "OcrPreprocessor::process");
+    if (!source) {
+        return nullptr;
+    }
+
+    OcrPreprocessTimings local;
+    QElapsedTimer total;
+    QElapsedTimer stage;
+    total.start();
+    stage.start();
+
+    Pix *image = pixClone(source);
+    if (!opts.enabled) {
+        return image;
+    }
+
+    // Colour carries nothing useful for text; drop to 8 bpp luminance
+    if (opts.grayscale && pixGetDepth(image) != 8 && pixGetDepth(image) != 1) {
+        advance(&image, pixConvertTo8(image, 0));
+    }
+    local.grayscaleUs = elapsedUs(stage);
+
+    // Phone photos are far larger than Tesseract needs; scale them to the target DPI
+    int resolution = opts.targetDpi;
+    if (opts.downscale && pixGetDepth(image) == 8) {
+        float factor = scaleFactorFor(image);
+        if (factor < 1.0f) {
+            advance(&image, pixScaleAreaMap(image, factor, factor));
+        } else {
+            int xres = pixGetXRes(image);
+            resolution = xres > 0 ? xres : opts.targetDpi;
+        }
+    }
+    pixSetResolution(image, resolution, resolution);
+    local.downscaleUs = elapsedUs(stage);
+
+    // Sauvola handles the uneven lighting of photographed paper better than a global threshold
+    if (opts.binarize && pixGetDepth(image) == 8) {
+        Pix *binary = nullptr;
+        if (pixSauvolaBinarize(image, opts.sauvolaHalfWindow, opts.sauvolaFactor, 1,
+                               nullptr, nullptr, nullptr, &binary) == 0 && binary) {
+            advance(&image, binary);
+        }
+    }
+    local.binarizeUs = elapsedUs(stage);
+
+    if (opts.deskew) {
+        advance(&image, pixDeskew(image, 0));
+    }
+    local.deskewUs = elapsedUs(stage);
+
+    pixSetResolution(image, resolution, resolution);
+    local.totalUs = total.nsecsElapsed() / 1000;
+
+    qDebug() << "OCR preprocessing:" << local.toString()
+             << "->" << pixGetWidth(image) << "x" << pixGetHeight(image) << "@" << pixGetDepth(image) << "bpp";
+
+    if (timings) {
+        *timings = local;
+    }
+    return image;
+}
+
+float OcrPreprocessor::scaleFactorFor(Pix *image) const {
+    int xres = pixGetXRes(image);
+
+    // Trust the file's DPI only when it is plausible; phones often write 72 regardless of content
+    if (xres > opts.targetDpi && xres <= 2400) {
+        return float(opts.targetDpi) / float(xres);
+    }
+
+    int longSide = qMax(pixGetWidth(image), pixGetHeight(image));
+    if (opts.maxLongSide > 0 && longSide > opts.maxLongSide) {
+        return float(opts.maxLongSide) / float(longSide);
+    }
+    return 1.0f;
+}
@@ -1,74 +1,287 @@
 #include "OcrScanner.h"
+#include "Trace.h"
 #include <QDebug>
 #include <QDir>
 #include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QPromise>
+#include <QSettings>
+#include <QtConcurrent/QtConcurrent>
+#include <tesseract/ocrclass.h>
 
-OcrScanner::OcrScanner() {
-    tess = new tesseract::TessBaseAPI();
-    
-    // Try to find tessdata directory
-    QStringList tessdataPaths = {
+namespace {
+const char *kTessdataSettingsKey = "ocr/tessdataPath";
+
+bool hasEnglishModel(const QString &path) {
+    return !path.isEmpty() && QFileInfo::exists(path + "/eng.traineddata");
+}
+
+// Share of the progress bar for loading and preprocessing; Tesseract's own progress fills the rest
+constexpr int kRecognitionStartPercent = 10;
+
+bool isCancelled(const OcrProgress *progress) {
+    return progress && progress->cancelled && progress->cancelled();
+}
+
+void report(const OcrProgress *progress, int percent) {
+    if (progress && progress->report) {
+        progress->report(percent);
+    }
+}
+
+// ETEXT_DESC callbacks; cancel_this carries the OcrProgress
+bool cancelRecognition(void *context, int /*words*/) {
+    return isCancelled(static_cast<const OcrProgress *>(context));
+}
+
+bool reportRecognition(ETEXT_DESC *monitor, int, int, int, int) {
+    report(static_cast<const OcrProgress *>(monitor->cancel_this),
+           kRecognitionStartPercent + monitor->progress * (100 - kRecognitionStartPercent) / 100);
+    return true;
+}
+
+QStringList candidateTessdataPaths() {
+    return {
         "C:/Program Files/Tesseract-OCR/tessdata",
         QCoreApplication::applicationDirPath() + "/tessdata",
         QDir::currentPath() + "/tessdata",
         "../tessdata",
         "tessdata"
     };
-    
-    bool initialized = false;
-    for (const QString& path : tessdataPaths) {
-        QDir dir(path);
-        if (dir.exists()) {
-            qDebug() << "Trying tessdata path:" << path;
-            if (tess->Init(path.toStdString().c_str(), "eng") == 0) {
-                qDebug() << "Tesseract initialized successfully with path:" << path;
-                initialized = true;
-                break;
-            }
-        }
-    }
-    
-    if (!initialized) {
-        qWarning() << "Could not initialize tesseract. Trying with nullptr...";
-        if (tess->Init(nullptr, "eng") != 0) {
-            qWarning() << "Tesseract initialization failed completely!";
-            qWarning() << "Please ensure tessdata folder is in one of these locations:";
-            for (const QString& path : tessdataPaths) {
-                qWarning() << "  -" << path;
-            }
-        }
-    }
+}
+}
+
+OcrScanner::OcrScanner() : tess(nullptr), warmUpStarted(false) {
+    // Tesseract is loaded lazily by warmUp() so constructing a Model stays cheap
+    scanThread.setMaxThreadCount(1);
 }
 
 OcrScanner::~OcrScanner() {
+    scanThread.waitForDone();
+    if (warmUpStarted) {
+        ready.waitForFinished();
+    }
     if (tess) {
         tess->End();
         delete tess;
     }
 }
 
+void OcrScanner::warmUp() {
+    if (warmUpStarted) {
+        return;
+    }
+    warmUpStarted = true;
+    
+    ready = QtConcurrent::run([this]() {
+        QElapsedTimer timer;
+        timer.start();
+        
+        auto *engine = new tesseract::TessBaseAPI();
+        if (!initializeEngine(engine)) {
+            delete engine;
+            return false;
+        }
+        
+        tess = engine;
+        qDebug() << "Tesseract warm-up finished in" << timer.elapsed() << "ms";
+        return true;
+    });
+}
+
+bool OcrScanner::isReady() const {
+    return warmUpStarted && ready.isFinished() && tess != nullptr;
+}
+
+QString OcrScanner::tessdataPath() {
+    // Resolved once per process; every engine initialisation after that reuses it
+    static const QString resolvedPath = []() {
+        QSettings settings;
+        
+        // A path that worked on a previous run skips the probing entirely
+        QString cachedPath = settings.value(kTessdataSettingsKey).toString();
+        if (hasEnglishModel(cachedPath)) {
+            return cachedPath;
+        }
+        
+        for (const QString &path : candidateTessdataPaths()) {
+            if (hasEnglishModel(path)) {
+                QString absolutePath = QDir(path).absolutePath();
+                settings.setValue(kTessdataSettingsKey, absolutePath);
+                return absolutePath;
+            }
+        }
+        
+        settings.remove(kTessdataSettingsKey);
+        return QString();
+    }();
+    return resolvedPath;
+}
+
+bool OcrScanner::initializeEngine(tesseract::TessBaseAPI *engine) {
+    QString path = tessdataPath();
+    
+    if (!path.isEmpty()) {
+        if (engine->Init(path.toStdString().c_str(), "eng") == 0) {
+            qDebug() << "Tesseract initialized successfully with path:" << path;
+            return true;
+        }
+        qWarning() << "Tesseract failed to initialize with path:" << path;
+    }
+    
+    qWarning() << "Could not initialize tesseract. Trying with nullptr...";
+    if (engine->Init(nullptr, "eng") != 0) {
+        qWarning() << "Tesseract initialization failed completely!";
+        qWarning() << "Please ensure tessdata folder is in one of these locations:";
+        for (const QString& candidate : candidateTessdataPaths()) {
+            qWarning() << "  -" << candidate;
+        }
+        return false;
+    }
+    return true;
+}
+
 QString OcrScanner::scanImage(const QString &filePath) {
+    PIPINO_TRACE_SCOPE("ocr", "OcrScanner::scanImage");
+    
+    // Wait for the background warm-up (or run it now if nobody started it)
+    {
+        PIPINO_TRACE_SCOPE("ocr", "OcrScanner::waitForEngine");
+        warmUp();
+        ready.waitForFinished();
+    }
+    
     // Check if API is properly initialized
-    if (!tess) {
+    if (!ready.result() || !tess) {
         qWarning() << "Tesseract API is not initialized!";
-        return "OCR Error: Tesseract not initialized";
+        return OcrResult::failure("Tesseract not initialized").textOrError();
     }
     
+    QMutexLocker locker(&engineMutex);
+    return recognize(tess, filePath, preprocessor).textOrError();
+}
+
+QFuture<OcrResult> OcrScanner::scanImageAsync(const QString &filePath) {
+    warmUp();
+    
+    // A copy, so changing the options later cannot race with the running scan
+    const OcrPreprocessor options = preprocessor;
+    return QtConcurrent::run(&scanThread, [this, filePath, options](QPromise<OcrResult> &promise) {
+        PIPINO_TRACE_THREAD_NAME("OCR scan");
+        PIPINO_TRACE_SCOPE("ocr", "OcrScanner::scanImageAsync");
+        promise.setProgressRange(0, 100);
+        
+        ready.waitForFinished();
+        if (!ready.result() || !tess) {
+            qWarning() << "Tesseract API is not initialized!";
+            promise.addResult(OcrResult::failure("Tesseract not initialized"));
+            return;
+        }
+        
+        OcrProgress progress;
+        progress.report = [&promise](int percent) { promise.setProgressValue(percent); };
+        progress.cancelled = [&promise]() { return promise.isCanceled(); };
+        
+        Pix *page = loadPage(filePath, options);
+        if (!page) {
+            promise.addResult(OcrResult::failure("Could not open image file"));
+            return;
+        }
+        report(&progress, kRecognitionStartPercent / 2);
+        
+        QMutexLocker locker(&engineMutex);
+        QVector<QRect> boxes = detectLines(tess, page);
+        report(&progress, kRecognitionStartPercent);
+        
+        OcrResult result;
+        if (boxes.isEmpty()) {
+            // Nothing the line finder recognised as text; block mode may still read it
+            pixDestroy(&page);
+            result = recognize(tess, filePath, options, &progress);
+        } else {
+            result.lines = recognizeLines(tess, page, boxes, &progress);
+            pixDestroy(&page);
+            if (result.lines.isEmpty()) {
+                result = OcrResult::failure("No text detected in image");
+            } else {
+                result.text = joinLines(result.lines);
+            }
+        }
+        
+        if (!promise.isCanceled()) {
+            promise.setProgressValue(100);
+            promise.addResult(result);
+        }
+    });
+}
+
+void OcrScanner::setPreprocessOptions(const OcrPreprocessOptions &options) {
+    preprocessor = OcrPreprocessor(options);
+}
+
+OcrResult OcrScanner::recognize(tesseract::TessBaseAPI *engine, const QString &filePath,
+                                const OcrPreprocessor &preprocessor, const OcrProgress *progress) {
+    PIPINO_TRACE_SCOPE("ocr", "OcrScanner::recognize");
     qDebug() << "Scanning image:" << filePath;
     
-    Pix *image = pixRead(filePath.toStdString().c_str());
-    if (!image) {
+    Pix *original = pixRead(filePath.toStdString().c_str());
+    if (!original) {
         qWarning() << "Could not open image:" << filePath;
-        return "OCR Error: Could not open image file";
+        return OcrResult::failure("Could not open image file");
+    }
+    
+    if (isCancelled(progress)) {
+        pixDestroy(&original);
+        return OcrResult::cancellation();
     }
+    report(progress, kRecognitionStartPercent / 2);
+    
+    // Hand Tesseract a lean 1 bpp page instead of the full-resolution colour photo
+    Pix *image = preprocessor.process(original);
+    pixDestroy(&original);
+    if (!image) {
+        qWarning() << "OCR preprocessing failed for:" << filePath;
+        return OcrResult::failure("Could not process image file");
+    }
+    if (isCancelled(progress)) {
+        pixDestroy(&image);
+        return OcrResult::cancellation();
+    }
+    report(progress, kRecognitionStartPercent);
 
-    tess->SetImage(image);
-    char *outText = tess->GetUTF8Text();
+    // Engines shared with line scans may have been left in single-line mode
+    engine->SetPageSegMode(tesseract::PSM_SINGLE_BLOCK);
+    engine->SetImage(image);
+    engine->SetSourceResolution(pixGetXRes(image));
+    
+    // Recognize() polls the monitor between words, so a cancelled scan stops mid-page
+    ETEXT_DESC monitor;
+    if (progress) {
+        monitor.cancel = cancelRecognition;
+        monitor.progress_callback2 = reportRecognition;
+        monitor.cancel_this = const_cast<OcrProgress *>(progress);
+    }
+    char *outText = nullptr;
+    {
+        PIPINO_TRACE_SCOPE("ocr", "TessBaseAPI::Recognize");
+        if (engine->Recognize(progress ? &monitor : nullptr) == 0 && !isCancelled(progress)) {
+            outText = engine->GetUTF8Text();
+        }
+    }
+    engine->Clear(); // Release the page image and layout results held by the engine
+    
+    if (isCancelled(progress)) {
+        delete[] outText;
+        pixDestroy(&image);
+        qDebug() << "OCR cancelled for:" << filePath;
+        return OcrResult::cancellation();
+    }
     
     if (!outText) {
         qWarning() << "OCR failed to extract text from image";
         pixDestroy(&image);
-        return "OCR Error: Failed to extract text";
+        return OcrResult::failure("Failed to extract text");
     }
     
     QString result = QString::fromUtf8(outText);
@@ -77,7 +290,127 @@ QString OcrScanner::scanImage(const QString &filePath) {
     delete[] outText;
     pixDestroy(&image);
 
-    return result.isEmpty() ? "OCR Error: No text detected in image" : result;
+    // Tesseract returns a bare newline for a blank page
+    if (result.trimmed().isEmpty()) {
+        return OcrResult::failure("No text detected in image");
+    }
+    return OcrResult::success(result);
+}
+
+QVector<OcrLine> OcrScanner::scanLines(const QString &filePath) {
+    PIPINO_TRACE_SCOPE("ocr", "OcrScanner::scanLines");
+    warmUp();
+    ready.waitForFinished();
+    
+    if (!ready.result() || !tess) {
+        qWarning() << "Tesseract API is not initialized!";
+        return QVector<OcrLine>();
+    }
+    
+    Pix *page = loadPage(filePath, preprocessor);
+    if (!page) {
+        return QVector<OcrLine>();
+    }
+    
+    QMutexLocker locker(&engineMutex);
+    QVector<QRect> boxes = detectLines(tess, page);
+    QVector<OcrLine> lines = recognizeLines(tess, page, boxes);
+    pixDestroy(&page);
+    
+    qDebug() << "OCR line scan found" << lines.size() << "lines in" << filePath;
+    return lines;
+}
+
+QVector<OcrLine> OcrScanner::recognizeLines(tesseract::TessBaseAPI *engine, Pix *page,
+                                            const QVector<QRect> &boxes, const OcrProgress *progress) {
+    // One SetImage for the whole page; each line is then just a SetRectangle
+    QVector<OcrLine> lines;
+    lines.reserve(boxes.size());
+    setLineImage(engine, page);
+    for (int i = 0; i < boxes.size(); ++i) {
+        if (isCancelled(progress)) {
+            break;
+        }
+        OcrLine line = recognizeLine(engine, boxes[i]);
+        if (!line.text.isEmpty()) {
+            lines.append(line);
+        }
+        report(progress, kRecognitionStartPercent + (i + 1) * (100 - kRecognitionStartPercent) / boxes.size());
+    }
+    engine->Clear();
+    return lines;
+}
+
+QString OcrScanner::joinLines(const QVector<OcrLine> &lines) {
+    QStringList texts;
+    texts.reserve(lines.size());
+    for (const OcrLine &line : lines) {
+        texts.append(line.text);
+    }
+    return texts.join('\n');
+}
+
+Pix *OcrScanner::loadPage(const QString &filePath, const OcrPreprocessor &preprocessor) {
+    Pix *original = pixRead(filePath.toStdString().c_str());
+    if (!original) {
+        qWarning() << "Could not open image:" << filePath;
+        return nullptr;
+    }
+    
+    Pix *page = preprocessor.process(original);
+    pixDestroy(&original);
+    return page;
+}
+
+QVector<QRect> OcrScanner::detectLines(tesseract::TessBaseAPI *engine, Pix *page) {
+    PIPINO_TRACE_SCOPE("ocr", "OcrScanner::detectLines");
+    // Small margin so ascenders/descenders cut off by the layout boxes are kept
+    const int padding = 4;
+    
+    tesseract::PageSegMode previousMode = engine->GetPageSegMode();
+    engine->SetPageSegMode(tesseract::PSM_AUTO);
+    engine->SetImage(page);
+    engine->SetSourceResolution(pixGetXRes(page));
+    
+    QVector<QRect> boxes;
+    QRect pageRect(0, 0, pixGetWidth(page), pixGetHeight(page));
+    Boxa *lineBoxes = engine->GetComponentImages(tesseract::RIL_TEXTLINE, true, nullptr, nullptr);
+    if (lineBoxes) {
+        int count = boxaGetCount(lineBoxes);
+        boxes.reserve(count);
+        for (int i = 0; i < count; ++i) {
+            l_int32 x = 0, y = 0, w = 0, h = 0;
+            if (boxaGetBoxGeometry(lineBoxes, i, &x, &y, &w, &h) == 0 && w > 0 && h > 0) {
+                boxes.append(QRect(x, y, w, h).adjusted(-padding, -padding, padding, padding) & pageRect);
+            }
+        }
+        boxaDestroy(&lineBoxes);
+    }
+    
+    engine->Clear();
+    engine->SetPageSegMode(previousMode);
+    return boxes;
+}
+
+void OcrScanner::setLineImage(tesseract::TessBaseAPI *engine, Pix *image) {
+    engine->SetPageSegMode(tesseract::PSM_SINGLE_LINE);
+    engine->SetImage(image);
+    engine->SetSourceResolution(pixGetXRes(image));
+}
+
+OcrLine OcrScanner::recognizeLine(tesseract::TessBaseAPI *engine, const QRect &box) {
+    PIPINO_TRACE_SCOPE("ocr", "OcrScanner::recognizeLine");
+    OcrLine line;
+    line.box = box;
+    
+    engine->SetRectangle(box.x(), box.y(), box.width(), box.height());
+    char *outText = engine->GetUTF8Text();
+    if (outText) {
+        line.text = QString::fromUtf8(outText).trimmed();
+        line.confidence = float(engine->MeanTextConf());
+        delete[] outText;
+    }
+    return line;
 }
 
 QString OcrScanner::getTextFromImage(const QString &filePath) {
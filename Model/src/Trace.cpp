@@ -0,0 +1,258 @@
+#include "Trace.h"
+
+#if PIPINO_TRACING
+
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace {
+// Events kept per thread; a power of two so the ring index is a mask
+constexpr quint64 kRingCapacity = 16384;
+
+enum class EventKind : quint8 { Span, Counter };
+
+struct Event {
+    const char *category;
+    const char *name;
+    qint64 startNs;
+    qint64 value;       // Duration for spans, the sampled value for counters
+    EventKind kind;
+};
+
+// Written only by its own thread; read by whoever exports
+struct ThreadBuffer {
+    std::vector<Event> events = std::vector<Event>(kRingCapacity);
+    std::atomic<quint64> written{0};
+    std::atomic<quint64> clearedAt{0};
+    std::atomic<const char *> name{nullptr};
+    int tid = 0;
+};
+
+// Buffers outlive their threads, so spans from finished workers still export. Pool workers
+// expire when idle and are recreated, so an exiting thread hands its ring to the free list
+// and the next new thread carries on writing into it; the registry never holds more rings
+// than there were threads alive at once.
+struct Registry {
+    QMutex mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    std::vector<std::shared_ptr<ThreadBuffer>> freeBuffers;
+    int nextTid = 1;
+};
+
+Registry &registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+std::atomic<bool> enabledFlag{false};
+
+std::chrono::steady_clock::time_point epoch()
+{
+    static const auto start = std::chrono::steady_clock::now();
+    return start;
+}
+
+// Owns the calling thread's ring and gives it back to the registry when the thread exits
+struct ThreadSlot {
+    std::shared_ptr<ThreadBuffer> buffer;
+
+    ThreadSlot()
+    {
+        Registry &reg = registry();
+        QMutexLocker locker(&reg.mutex);
+        if (!reg.freeBuffers.empty()) {
+            // Keeps the ring's events and trace lane; only the label belongs to the old thread
+            buffer = std::move(reg.freeBuffers.back());
+            reg.freeBuffers.pop_back();
+            buffer->name.store(nullptr, std::memory_order_relaxed);
+        } else {
+            buffer = std::make_shared<ThreadBuffer>();
+            buffer->tid = reg.nextTid++;
+            reg.buffers.push_back(buffer);
+        }
+    }
+
+    ~ThreadSlot()
+    {
+        Registry &reg = registry();
+        QMutexLocker locker(&reg.mutex);
+        reg.freeBuffers.push_back(std::move(buffer));
+    }
+};
+
+ThreadBuffer &threadBuffer()
+{
+    // Registration takes the lock once per thread; recording never does
+    thread_local ThreadSlot slot;
+    return *slot.buffer;
+}
+
+void push(const Event &event)
+{
+    ThreadBuffer &buffer = threadBuffer();
+    quint64 index = buffer.written.load(std::memory_order_relaxed);
+    buffer.events[index & (kRingCapacity - 1)] = event;
+    buffer.written.store(index + 1, std::memory_order_release);
+}
+
+struct ThreadEvents {
+    int tid;
+    const char *name;
+    std::vector<Event> events;
+};
+
+std::vector<ThreadEvents> snapshot()
+{
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        Registry &reg = registry();
+        QMutexLocker locker(&reg.mutex);
+        buffers = reg.buffers;
+    }
+
+    std::vector<ThreadEvents> result;
+    result.reserve(buffers.size());
+    for (const auto &buffer : buffers) {
+        quint64 written = buffer->written.load(std::memory_order_acquire);
+        quint64 first = written > kRingCapacity ? written - kRingCapacity : 0;
+        first = std::max(first, buffer->clearedAt.load(std::memory_order_relaxed));
+
+        ThreadEvents copy{buffer->tid, buffer->name.load(std::memory_order_relaxed), {}};
+        copy.events.reserve(written - first);
+        for (quint64 i = first; i < written; ++i) {
+            copy.events.push_back(buffer->events[i & (kRingCapacity - 1)]);
+        }
+        result.push_back(std::move(copy));
+    }
+    return result;
+}
+
+double toMicros(qint64 ns)
+{
+    return ns / 1000.0;
+}
+}
+
+namespace Trace {
+
+qint64 now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch()).count();
+}
+
+bool isEnabled()
+{
+    return enabledFlag.load(std::memory_order_relaxed);
+}
+
+void setEnabled(bool enabled)
+{
+    epoch(); // Pin the time origin before the first span
+    enabledFlag.store(enabled, std::memory_order_relaxed);
+}
+
+void setThreadName(const char *name)
+{
+    threadBuffer().name.store(name, std::memory_order_relaxed);
+}
+
+void recordElapsed(const char *category, const char *name, qint64 durationNs)
+{
+    qint64 end = now();
+    recordSpan(category, name, end - durationNs, end);
+}
+
+void recordSpan(const char *category, const char *name, qint64 startNs, qint64 endNs)
+{
+    push(Event{category, name, startNs, qMax<qint64>(0, endNs - startNs), EventKind::Span});
+}
+
+void recordCounter(const char *category, const char *name, qint64 value)
+{
+    push(Event{category, name, now(), value, EventKind::Counter});
+}
+
+QVector<SpanStats> summarize()
+{
+    QHash<QString, SpanStats> byName;
+    for (const ThreadEvents &thread : snapshot()) {
+        for (const Event &event : thread.events) {
+            if (event.kind != EventKind::Span) continue;
+
+            QString name = QLatin1String(event.name);
+            SpanStats &stats = byName[name];
+            stats.name = name;
+            double ms = event.value / 1e6;
+            ++stats.count;
+            stats.totalMs += ms;
+            stats.maxMs = qMax(stats.maxMs, ms);
+        }
+    }
+
+    QVector<SpanStats> result(byName.begin(), byName.end());
+    std::sort(result.begin(), result.end(), [](const SpanStats &a, const SpanStats &b) {
+        return a.totalMs > b.totalMs;
+    });
+    return result;
+}
+
+bool exportChromeJson(const QString &filePath)
+{
+    QJsonArray traceEvents;
+    for (const ThreadEvents &thread : snapshot()) {
+        if (thread.name) {
+            traceEvents.append(QJsonObject{
+                {"ph", "M"}, {"name", "thread_name"}, {"pid", 1}, {"tid", thread.tid},
+                {"args", QJsonObject{{"name", QLatin1String(thread.name)}}}
+            });
+        }
+
+        for (const Event &event : thread.events) {
+            QJsonObject json{
+                {"name", QLatin1String(event.name)},
+                {"cat", QLatin1String(event.category)},
+                {"ts", toMicros(event.startNs)},
+                {"pid", 1},
+                {"tid", thread.tid}
+            };
+            if (event.kind == EventKind::Span) {
+                json.insert("ph", "X");
+                json.insert("dur", toMicros(event.value));
+            } else {
+                json.insert("ph", "C");
+                json.insert("args", QJsonObject{{QLatin1String(event.name), double(event.value)}});
+            }
+            traceEvents.append(json);
+        }
+    }
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    QJsonObject root{{"traceEvents", traceEvents}, {"displayTimeUnit", "ms"}};
+    return file.write(QJsonDocument(root).toJson(QJsonDocument::Compact)) >= 0;
+}
+
+void clear()
+{
+    Registry &reg = registry();
+    QMutexLocker locker(&reg.mutex);
+    for (const auto &buffer : reg.buffers) {
+        buffer->clearedAt.store(buffer->written.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+}
+
+} // namespace Trace
+
+#endif // PIPINO_TRACING
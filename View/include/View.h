@@ -14,6 +14,7 @@
 #include <QGroupBox>
 #include <QPushButton>
 #include <QStackedWidget>
+#include <QFutureWatcher>
 #include "ui_MainWindow.h"
 #include "ui_MultipleChoiceWindow.h"
 #include "ui_SettingsWindow.h"
@@ -21,9 +22,12 @@
 #include "ui_TheoryWindow.h"
 #include "ui_ScanResultWindow.h"
 #include "ui_ScanReviewWindow.h"
+#include "AiResult.h"
+#include "OcrResult.h"
 
 class Model;
 class Controller;
+class SolutionGrader;
 
 enum class WindowType {
     MainWindow,
@@ -53,7 +57,7 @@ public:
     void showMultipleChoiceWindow(int unitIndex, int problemIndex);
     void showSettingsWindow(WindowType previousWindow);
     void showScanWindow(int unitIndex, int problemIndex);
-    void showScanResultWindow(const QString& ocrResult);
+    void showScanResultWindow(const OcrResult& scan);
     void showScanReviewWindow(const QString& gradingResult);
     void showTheoryWindow(int unitIndex, int problemIndex, WindowType previousWindow);
     
@@ -71,10 +75,14 @@ signals:
 
 private slots:
     void onProblemSelectionChanged();
+    void onProblemContentChanged(int unitIndex, int problemIndex);
     void onBackButtonClicked();
     void onSettingsButtonClicked();
     void onMainSettingsButtonClicked();
     void onScanButtonClicked();
+    void onScanProgress(int percent);
+    void onScanFinished();
+    void cancelScan();
     void onTheoryButtonClicked();
     void onChoiceButtonClicked();
     void onDifficultyChanged(int index);
@@ -84,6 +92,8 @@ private slots:
     void onScanResultNextButtonClicked();
     void onScanReviewBackButtonClicked();
     void onScanReviewMenuButtonClicked();
+    void onFeedbackChunk(quint64 requestId, const QString& chunk);
+    void onFeedbackStreamFinished(quint64 requestId, const AiResult<QString>& feedback);
 
 private:
     // UI objects for all windows
@@ -115,9 +125,20 @@ private:
     
     // Scan workflow state
     QString currentScanImagePath;
-    QString currentOcrResult;
+    QFutureWatcher<OcrResult>* scanWatcher; // OCR job for the scan window; running while a scan is in progress
+    QString scanButtonText;               // Scan window texts, restored once a scan ends
+    QString scanInstructionText;
+    OcrResult currentScan;                // Last successful scan, shown in the result window
     QString currentProblemStatement;
     QString currentGradingResult;
+    SolutionGrader* solutionGrader;
+    quint64 feedbackStreamId;   // Feedback currently streaming into the review window, 0 if none
+    
+    // Grading starts speculatively when the OCR result is shown; these identify what it was
+    // started for, so Next can reuse it when nothing changed
+    QString gradedSolution;
+    QString gradedProblem;
+    bool gradingSucceeded;      // The feedback for gradedSolution finished without error
     
     // Main window components
     QVBoxLayout* unitsLayout;
@@ -151,6 +172,12 @@ private:
     // Content population methods
     void populateTheoryWindow(int unitIndex, int problemIndex);
     void populateScanWindow(int unitIndex, int problemIndex);
+    void setScanInProgress(bool inProgress);
+    void updateScanButtonEnabled();
+    
+    // Scan workflow grading
+    void startGrading(const OcrResult& scan);
+    void resetGrading();
 };
 
 #endif // VIEW_H
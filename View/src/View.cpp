@@ -2,12 +2,64 @@
 #include "Model.h"
 #include "Controller.h"
 #include "SolutionGrader.h"
+#include "Trace.h"
 #include <QApplication>
 #include <QDebug>
 #include <QTimer>
 #include <QFileDialog>
 #include <QMessageBox>
 
+#if PIPINO_TRACING
+#include <QEvent>
+#include <QHash>
+
+namespace {
+// Records the time from opening or updating a dialog to its next paint, i.e. until
+// the user actually sees the change. Paint happens inside the dialog's own event loop,
+// so it cannot be covered by a scope around exec().
+class PaintTracer : public QObject
+{
+public:
+    void arm(QWidget* widget, const char* name)
+    {
+        if (!Trace::isEnabled()) return;
+        pending.insert(widget, Pending{name, Trace::now()});
+        widget->installEventFilter(this);
+    }
+
+protected:
+    bool eventFilter(QObject* watched, QEvent* event) override
+    {
+        if (event->type() == QEvent::Paint) {
+            auto it = pending.find(watched);
+            if (it != pending.end()) {
+                Trace::recordSpan("view", it->name, it->startNs, Trace::now());
+                pending.erase(it);
+            }
+        }
+        return QObject::eventFilter(watched, event);
+    }
+
+private:
+    struct Pending {
+        const char* name;
+        qint64 startNs;
+    };
+    QHash<QObject*, Pending> pending;
+};
+
+PaintTracer& paintTracer()
+{
+    static PaintTracer tracer;
+    return tracer;
+}
+}
+
+#define TRACE_UNTIL_PAINTED(widget, name) paintTracer().arm(widget, name)
+#else
+#define TRACE_UNTIL_PAINTED(widget, name) do {} while (0)
+#endif
+
 View::View(QWidget *parent)
     : QMainWindow(parent)
     , mainUI(nullptr)
@@ -23,6 +75,7 @@ View::View(QWidget *parent)
     , theoryWindow(nullptr)
     , scanResultWindow(nullptr)
     , scanReviewWindow(nullptr)
+    , scanWatcher(nullptr)
     , controller(nullptr)
     , model(nullptr)
     , currentWindow(WindowType::MainWindow)
@@ -30,9 +83,16 @@ View::View(QWidget *parent)
     , currentUnitIndex(-1)
     , currentProblemIndex(-1)
     , correctChoiceIndex(-1)
+    , solutionGrader(nullptr)
+    , feedbackStreamId(0)
+    , gradingSucceeded(false)
     , unitsLayout(nullptr)
 {
     setupUI();
+    
+    solutionGrader = new SolutionGrader(this);
+    connect(solutionGrader, &SolutionGrader::feedbackChunk, this, &View::onFeedbackChunk);
+    connect(solutionGrader, &SolutionGrader::feedbackStreamFinished, this, &View::onFeedbackStreamFinished);
 }
 
 View::~View()
@@ -57,6 +117,7 @@ void View::setModel(Model* mdl)
     if (model) {
         connect(model, &Model::unitsChanged, this, &View::refreshUnits);
         connect(model, &Model::unitProblemsChanged, this, &View::updateUnitProblems);
+        connect(model, &Model::problemContentChanged, this, &View::onProblemContentChanged);
         refreshUnits();
     }
 }
@@ -116,6 +177,16 @@ void View::setupScanWindow()
     scanWindow->setModal(true);
     scanUI = new Ui::ScanWindow();
     scanUI->setupUi(scanWindow);
+    scanButtonText = scanUI->scanButton->text();
+    scanInstructionText = scanUI->instructionLabel->text();
+    
+    // OCR runs in the background; the window stays responsive and the scan button cancels it
+    scanWatcher = new QFutureWatcher<OcrResult>(this);
+    connect(scanWatcher, &QFutureWatcher<OcrResult>::progressValueChanged, this, &View::onScanProgress);
+    connect(scanWatcher, &QFutureWatcher<OcrResult>::finished, this, &View::onScanFinished);
+    
+    // Leaving the window by any route (back button, Esc, close) drops a running scan
+    connect(scanWindow, &QDialog::finished, this, &View::cancelScan);
 }
 
 void View::setupScanResultWindow()
@@ -213,6 +284,7 @@ void View::showMultipleChoiceWindow(int unitIndex, int problemIndex)
         this->y() + (this->height() - multipleChoiceWindow->height()) / 2
     );
     
+    TRACE_UNTIL_PAINTED(multipleChoiceWindow, "View::openToFirstPaint");
     multipleChoiceWindow->exec(); // Show as modal dialog
 }
 
@@ -239,8 +311,9 @@ void View::showScanWindow(int unitIndex, int problemIndex)
     
     populateScanWindow(unitIndex, problemIndex);
     
-    // Store the AI-generated problem statement for later use
-    currentProblemStatement = model->getProblemStatement(unitIndex, problemIndex);
+    // Store the AI-generated problem statement for grading; empty until it has been generated
+    const ProblemView problem = model->problemView(unitIndex, problemIndex);
+    currentProblemStatement = problem.hasContent ? problem.statement : QString();
     
     // Center the dialog over the main window
     scanWindow->move(
@@ -248,19 +321,23 @@ void View::showScanWindow(int unitIndex, int problemIndex)
         this->y() + (this->height() - scanWindow->height()) / 2
     );
     
+    TRACE_UNTIL_PAINTED(scanWindow, "View::openToFirstPaint");
     scanWindow->exec(); // Show as modal dialog
 }
 
-void View::showScanResultWindow(const QString& ocrResult)
+void View::showScanResultWindow(const OcrResult& scan)
 {
     previousWindow = currentWindow;
     currentWindow = WindowType::ScanResultWindow;
-    currentOcrResult = ocrResult;
+    currentScan = scan;
     
     // Set the OCR result in the label
-    scanResultUI->scanResultLabel->setText(ocrResult);
+    scanResultUI->scanResultLabel->setText(scan.text);
     scanResultUI->scanResultTitleLabel->setText("Scan Result");
     
+    // Grade while the student is still reading the text; Next then usually finds the answer ready
+    startGrading(scan);
+    
     // Center the dialog
     scanResultWindow->move(
         this->x() + (this->width() - scanResultWindow->width()) / 2,
@@ -276,8 +353,8 @@ void View::showScanReviewWindow(const QString& gradingResult)
     currentWindow = WindowType::ScanReviewWindow;
     currentGradingResult = gradingResult;
     
-    // Set the grading result in the label
-    scanReviewUI->scanReviewLabel->setText(gradingResult);
+    // Set the grading result in the label; streamed feedback fills it in as it arrives
+    scanReviewUI->scanReviewLabel->setText(gradingResult.isEmpty() ? tr("Grading your solution...") : gradingResult);
     scanReviewUI->scanReviewTitleLabel->setText("Solution Review");
     
     // Center the dialog
@@ -311,22 +388,26 @@ void View::showTheoryWindow(int unitIndex, int problemIndex, WindowType prevWind
 void View::populateMultipleChoiceWindow(int unitIndex, int problemIndex)
 {
     if (!model || !multipleChoiceUI) return;
+    PIPINO_TRACE_SCOPE("view", "View::populateMultipleChoiceWindow");
+    
+    // One lookup for everything the dialog shows; this runs again on every content update
+    const ProblemView problem = model->problemView(unitIndex, problemIndex);
     
     // Set unit and problem label
-    QString unitProblemText = model->unitProblemToString(unitIndex, problemIndex);
-    multipleChoiceUI->unitLabel->setText(unitProblemText);
+    multipleChoiceUI->unitLabel->setText(problem.valid ? problem.title() : QString("Invalid unit or problem"));
     
     // Set problem statement
-    QString problemStatement = model->getProblemStatement(unitIndex, problemIndex);
-    if (problemStatement.isEmpty() || problemStatement == "Problem not found") {
+    if (!problem.valid) {
+        multipleChoiceUI->problemLabel->setText("Problem not found");
+    } else if (problem.statement.isEmpty()) {
         multipleChoiceUI->problemLabel->setText("Generating problem... Please wait.");
     } else {
-        multipleChoiceUI->problemLabel->setText(problemStatement);
+        multipleChoiceUI->problemLabel->setText(problem.statement);
     }
     
     // Set multiple choice options
-    QVector<MultipleChoiceOption> choices = model->getMultipleChoiceOptions(unitIndex, problemIndex);
-    correctChoiceIndex = model->getCorrectChoiceIndex(unitIndex, problemIndex);
+    const QVector<MultipleChoiceOption>& choices = problem.choices;
+    correctChoiceIndex = problem.correctChoiceIndex;
     
     if (choices.size() >= 4) {
         multipleChoiceUI->choiceButton1->setText(choices[0].text);
@@ -364,13 +445,32 @@ void View::populateTheoryWindow(int unitIndex, int problemIndex)
 void View::populateScanWindow(int unitIndex, int problemIndex)
 {
     if (!model || !scanUI) return;
+    PIPINO_TRACE_SCOPE("view", "View::populateScanWindow");
+    
+    const ProblemView problem = model->problemView(unitIndex, problemIndex);
+    scanUI->unitLabel->setText(problem.valid ? problem.title() : QString("Invalid unit or problem"));
     
-    QString unitProblemText = model->unitProblemToString(unitIndex, problemIndex);
-    scanUI->unitLabel->setText(unitProblemText);
+    // Display AI-generated problem statement, or the generating state until it arrives
+    if (!problem.valid) {
+        scanUI->scanProblemLabel->setText("Problem not found");
+    } else if (problem.statement.isEmpty()) {
+        scanUI->scanProblemLabel->setText("Generating problem... Please wait.");
+    } else {
+        scanUI->scanProblemLabel->setText(problem.statement);
+    }
     
-    // Display AI-generated problem statement (should already be generated by the time window opens)
-    QString problemStatement = model->getProblemStatement(unitIndex, problemIndex);
-    scanUI->scanProblemLabel->setText(problemStatement);
+    updateScanButtonEnabled();
+}
+
+void View::updateScanButtonEnabled()
+{
+    if (!model || !scanUI) return;
+    
+    // There is nothing to grade a scan against until the problem has been generated, and a
+    // cancelled scan keeps the button until Tesseract has actually stopped
+    const ProblemView problem = model->problemView(currentUnitIndex, currentProblemIndex);
+    bool cancelling = scanWatcher->isRunning() && scanWatcher->isCanceled();
+    scanUI->scanButton->setEnabled(problem.hasContent && !cancelling);
 }
 
 // Button event handlers
@@ -383,23 +483,54 @@ void View::onProblemSelectionChanged()
     int problemIndex = senderCombo->currentIndex() - 1; // -1 because first item is "-- Choose a problem --"
     
     if (problemIndex >= 0) {
-        // Trigger AI generation first for all problems
+        PIPINO_TRACE_SCOPE("view", "View::onProblemSelectionChanged");
+        
+        // Start AI generation; it runs in the background and fills the dialog when done
         emit problemSelected(unitIndex, problemIndex);
         
+        // Open the dialog right away in its "generating" state. The zero-delay timer only
+        // lets the combo box finish its own signal handling before the modal loop starts.
         if (problemIndex < 3) {
-            // Use QTimer to allow AI to generate before showing MC window
-            QTimer::singleShot(100, this, [this, unitIndex, problemIndex]() {
+            QTimer::singleShot(0, this, [this, unitIndex, problemIndex]() {
                 showMultipleChoiceWindow(unitIndex, problemIndex);
             });
         } else {
-            // For scan window, also wait for AI generation to complete
-            QTimer::singleShot(100, this, [this, unitIndex, problemIndex]() {
+            QTimer::singleShot(0, this, [this, unitIndex, problemIndex]() {
                 showScanWindow(unitIndex, problemIndex);
             });
         }
     }
 }
 
+void View::onProblemContentChanged(int unitIndex, int problemIndex)
+{
+    if (unitIndex != currentUnitIndex || problemIndex != currentProblemIndex) return;
+    
+    // Fill in generated content for whichever problem dialog is still open
+    if (multipleChoiceWindow && multipleChoiceWindow->isVisible()) {
+        refreshMultipleChoice(unitIndex, problemIndex);
+        TRACE_UNTIL_PAINTED(multipleChoiceWindow, "View::contentToPaint");
+    }
+    if (scanWindow && scanWindow->isVisible()) {
+        populateScanWindow(unitIndex, problemIndex);
+        TRACE_UNTIL_PAINTED(scanWindow, "View::contentToPaint");
+    }
+    
+    // A scan already past OCR is graded again against the statement that just arrived
+    const ProblemView problem = model->problemView(unitIndex, problemIndex);
+    QString statement = problem.hasContent ? problem.statement : QString();
+    if (statement != currentProblemStatement) {
+        currentProblemStatement = statement;
+        if (currentWindow == WindowType::ScanResultWindow || currentWindow == WindowType::ScanReviewWindow) {
+            startGrading(currentScan);
+            if (currentWindow == WindowType::ScanReviewWindow) {
+                scanReviewUI->scanReviewLabel->setText(currentGradingResult.isEmpty() ? tr("Grading your solution...")
+                                                                                      : currentGradingResult);
+            }
+        }
+    }
+}
+
 void View::onBackButtonClicked()
 {
     // Close the current dialog and restore previous state
@@ -439,6 +570,12 @@ void View::onSettingsButtonClicked()
 
 void View::onScanButtonClicked()
 {
+    // While a scan is running the button cancels it, so a second click cannot queue another
+    if (scanWatcher->isRunning()) {
+        cancelScan();
+        return;
+    }
+    
     // Open file dialog to select .png file
     QString fileName = QFileDialog::getOpenFileName(
         scanWindow,
@@ -459,18 +596,65 @@ void View::onScanButtonClicked()
         return;
     }
     
-    QString ocrResult = model->scanImage(fileName);
+    setScanInProgress(true);
+    scanWatcher->setFuture(model->scanImageAsync(fileName));
     
-    if (ocrResult.isEmpty()) {
-        QMessageBox::warning(scanWindow, tr("Error"), tr("Failed to scan image!"));
+    emit scanButtonClicked();
+}
+
+void View::onScanProgress(int percent)
+{
+    scanUI->instructionLabel->setText(tr("🔍 Reading your solution... %1%").arg(percent));
+}
+
+void View::onScanFinished()
+{
+    setScanInProgress(false);
+    
+    // Cancelled, or the user left the scan window while it ran
+    if (scanWatcher->isCanceled() || scanWatcher->future().resultCount() == 0 || !scanWindow->isVisible()) {
         return;
     }
     
-    // Close scan window and show result window
+    // A failed scan is reported, never shown as the result or sent for grading
+    const OcrResult scan = scanWatcher->result();
+    if (!scan.ok()) {
+        QMessageBox::warning(scanWindow, tr("Error"), tr("Failed to scan image: %1").arg(scan.error));
+        return;
+    }
+    
+    // Close scan window and show result window. The zero-delay timer lets the watcher finish
+    // delivering its signal before the result window's modal loop starts.
     scanWindow->accept();
-    showScanResultWindow(ocrResult);
+    QTimer::singleShot(0, this, [this, scan]() {
+        showScanResultWindow(scan);
+    });
+}
+
+void View::cancelScan()
+{
+    if (!scanWatcher || !scanWatcher->isRunning()) return;
+    
+    // Tesseract notices at its next check and the job finishes without a result. Until then
+    // the button stays disabled; onScanFinished gives it back.
+    scanWatcher->cancel();
+    scanUI->scanButton->setText(tr("Cancelling..."));
+    scanUI->instructionLabel->setText(tr("Stopping the scan..."));
+    updateScanButtonEnabled();
+}
+
+void View::setScanInProgress(bool inProgress)
+{
+    if (!scanUI) return;
     
-    emit scanButtonClicked();
+    if (inProgress) {
+        scanUI->scanButton->setText(tr("Cancel scan"));
+        scanUI->instructionLabel->setText(tr("🔍 Reading your solution... 0%"));
+    } else {
+        scanUI->scanButton->setText(scanButtonText);
+        scanUI->instructionLabel->setText(scanInstructionText);
+    }
+    updateScanButtonEnabled();
 }
 
 void View::onTheoryButtonClicked()
@@ -520,7 +704,8 @@ void View::onMainSettingsButtonClicked()
 
 void View::onScanResultBackButtonClicked()
 {
-    // Go back to scan window, preserving state
+    // Go back to scan window, preserving state; the speculative grading is for a scan being discarded
+    resetGrading();
     scanResultWindow->reject();
     showScanWindow(currentUnitIndex, currentProblemIndex);
 }
@@ -533,29 +718,83 @@ void View::onScanResultNextButtonClicked()
         return;
     }
     
-    // Create a SolutionGrader instance
-    SolutionGrader grader;
-    QString gradingResult = grader.gradeSolution(currentOcrResult, currentProblemStatement);
+    // Reuses the speculative grading started with the result window, unless the text changed since
+    startGrading(currentScan);
     
-    // Close result window and show review window
+    // Close result window and show review window with whatever feedback has streamed in so far
     scanResultWindow->accept();
-    showScanReviewWindow(gradingResult);
+    showScanReviewWindow(currentGradingResult);
 }
 
 void View::onScanReviewBackButtonClicked()
 {
-    // Go back to scan result window, preserving state
+    // Go back to scan result window, preserving state. The feedback is kept, so pressing
+    // Next again on the same text shows it without another request.
     scanReviewWindow->reject();
-    showScanResultWindow(currentOcrResult);
+    showScanResultWindow(currentScan);
 }
 
 void View::onScanReviewMenuButtonClicked()
 {
     // Go back to main menu
+    resetGrading();
     scanReviewWindow->accept();
     showMainWindow();
 }
 
+void View::onFeedbackChunk(quint64 requestId, const QString& chunk)
+{
+    if (requestId != feedbackStreamId) return; // From a stream the user already left
+    
+    currentGradingResult += chunk;
+    scanReviewUI->scanReviewLabel->setText(currentGradingResult);
+}
+
+void View::onFeedbackStreamFinished(quint64 requestId, const AiResult<QString>& feedback)
+{
+    if (requestId != feedbackStreamId) return;
+    
+    feedbackStreamId = 0;
+    gradingSucceeded = feedback.ok();
+    currentGradingResult = feedback.ok() ? feedback.value() : feedback.errorString();
+    scanReviewUI->scanReviewLabel->setText(currentGradingResult);
+}
+
+void View::startGrading(const OcrResult& scan)
+{
+    // Streaming or finished feedback for exactly this text and problem is still good
+    bool sameInput = scan.text == gradedSolution && currentProblemStatement == gradedProblem;
+    if (sameInput && (feedbackStreamId != 0 || gradingSucceeded)) {
+        return;
+    }
+    
+    // The text or problem changed, or the last attempt failed: drop it and grade afresh
+    resetGrading();
+    
+    // Never grade against a missing or placeholder statement; onProblemContentChanged
+    // starts again once the real one arrives
+    if (currentProblemStatement.isEmpty()) {
+        currentGradingResult = tr("Waiting for the problem to finish generating before grading...");
+        return;
+    }
+    
+    gradedSolution = scan.text;
+    gradedProblem = currentProblemStatement;
+    
+    // The lines go in as numbered steps so the feedback can point at the one that went wrong
+    feedbackStreamId = solutionGrader->streamDetailedFeedback(scan.steps(), currentProblemStatement);
+}
+
+void View::resetGrading()
+{
+    solutionGrader->cancelStream(feedbackStreamId);
+    feedbackStreamId = 0;
+    gradingSucceeded = false;
+    gradedSolution.clear();
+    gradedProblem.clear();
+    currentGradingResult.clear();
+}
+
 // Helper methods
 void View::setChoiceButtonsEnabled(bool enabled)
 {
@@ -615,6 +854,7 @@ void View::refreshMultipleChoice(int unitIndex, int problemIndex)
 void View::refreshUnits()
 {
     if (!model) return;
+    PIPINO_TRACE_SCOPE("view", "View::refreshUnits");
     
     clearUnitsLayout();
     
@@ -8,10 +8,34 @@
 #include "SolutionGrader.h"
 #include <iostream>
 #include <QDebug>
+#include <QTimer>
 #include "OcrScanner.h"
+#include "Trace.h"
 int main(int argc, char *argv[])
 {
     QApplication app(argc, argv);
+    app.setOrganizationName("DRBC-Systems");
+    app.setApplicationName("PipinoCosmos");
+    
+#if PIPINO_TRACING
+    // PIPINO_TRACE=<file.json> records spans and writes them out on quit (open in chrome://tracing)
+    const QString tracePath = qEnvironmentVariable("PIPINO_TRACE");
+    if (!tracePath.isEmpty()) {
+        Trace::setEnabled(true);
+        Trace::setThreadName("GUI");
+        QObject::connect(&app, &QCoreApplication::aboutToQuit, [tracePath]() {
+            for (const Trace::SpanStats& span : Trace::summarize()) {
+                qDebug().noquote() << QString("trace %1: n=%2 total=%3ms mean=%4ms max=%5ms")
+                                          .arg(span.name, -40).arg(span.count)
+                                          .arg(span.totalMs, 0, 'f', 1).arg(span.meanMs(), 0, 'f', 2)
+                                          .arg(span.maxMs, 0, 'f', 2);
+            }
+            if (!Trace::exportChromeJson(tracePath)) {
+                qWarning() << "Could not write trace to" << tracePath;
+            }
+        });
+    }
+#endif
     
     // Create MVC components
     Model model;
@@ -27,6 +51,9 @@ int main(int argc, char *argv[])
     
     // Show the main window
     view.show();
+    
+    // Load Tesseract in the background once the window has had a chance to paint
+    QTimer::singleShot(0, &model, &Model::warmUpOcr);
 
     // // -----------------------------
     // // Run AI tests
@@ -86,19 +113,19 @@ int main(int argc, char *argv[])
     std::cout << "Student Solution: " << testSolution.toStdString() << std::endl;
     std::cout << "\n🤖 AI Tutor: Grading solution..." << std::endl;
     
-    QString gradingFeedback = solutionGrader.gradeSolution(testSolution, testProblem);
+    AiResult<QString> gradingFeedback = solutionGrader.gradeSolution(testSolution, testProblem);
     
-    if (gradingFeedback.startsWith("Error:") || gradingFeedback.startsWith("Timeout:")) {
-        std::cout << "❌ Grading failed: " << gradingFeedback.toStdString() << std::endl;
+    if (!gradingFeedback.ok()) {
+        std::cout << "❌ Grading failed: " << gradingFeedback.errorString().toStdString() << std::endl;
     } else {
-        std::cout << "🤖 AI Tutor: " << gradingFeedback.toStdString() << std::endl;
+        std::cout << "🤖 AI Tutor: " << gradingFeedback.value().toStdString() << std::endl;
         
         // Simulate student asking for more details
         std::cout << "\n👤 Student: Can you explain more?" << std::endl;
         std::cout << "🤖 AI Tutor: Getting detailed feedback..." << std::endl;
         
-        QString detailedFeedback = solutionGrader.getDetailedFeedback(testSolution, testProblem);
-        std::cout << "🤖 AI Tutor: " << detailedFeedback.toStdString() << std::endl;
+        AiResult<QString> detailedFeedback = solutionGrader.getDetailedFeedback(testSolution, testProblem);
+        std::cout << "🤖 AI Tutor: " << (detailedFeedback.ok() ? detailedFeedback.value() : detailedFeedback.errorString()).toStdString() << std::endl;
     }
     
     // Test with incorrect solution
@@ -107,19 +134,19 @@ int main(int argc, char *argv[])
     std::cout << "Student Solution: " << testSolution2.toStdString() << std::endl;
     std::cout << "\n🤖 AI Tutor: Grading solution..." << std::endl;
     
-    QString gradingFeedback2 = solutionGrader.gradeSolution(testSolution2, testProblem2);
+    AiResult<QString> gradingFeedback2 = solutionGrader.gradeSolution(testSolution2, testProblem2);
     
-    if (gradingFeedback2.startsWith("Error:") || gradingFeedback2.startsWith("Timeout:")) {
-        std::cout << "❌ Grading failed: " << gradingFeedback2.toStdString() << std::endl;
+    if (!gradingFeedback2.ok()) {
+        std::cout << "❌ Grading failed: " << gradingFeedback2.errorString().toStdString() << std::endl;
     } else {
-        std::cout << "🤖 AI Tutor: " << gradingFeedback2.toStdString() << std::endl;
+        std::cout << "🤖 AI Tutor: " << gradingFeedback2.value().toStdString() << std::endl;
         
         // Simulate student asking for help
         std::cout << "\n👤 Student: I don't understand. Can you help me?" << std::endl;
         std::cout << "🤖 AI Tutor: Getting detailed feedback..." << std::endl;
         
-        QString detailedFeedback2 = solutionGrader.getDetailedFeedback(testSolution2, testProblem2);
-        std::cout << "🤖 AI Tutor: " << detailedFeedback2.toStdString() << std::endl;
+        AiResult<QString> detailedFeedback2 = solutionGrader.getDetailedFeedback(testSolution2, testProblem2);
+        std::cout << "🤖 AI Tutor: " << (detailedFeedback2.ok() ? detailedFeedback2.value() : detailedFeedback2.errorString()).toStdString() << std::endl;
     }
     
     // Test with partially correct solution
@@ -128,19 +155,19 @@ int main(int argc, char *argv[])
     std::cout << "Student Solution: " << testSolution3.toStdString() << std::endl;
     std::cout << "\n🤖 AI Tutor: Grading solution..." << std::endl;
     
-    QString gradingFeedback3 = solutionGrader.gradeSolution(testSolution3, testProblem3);
+    AiResult<QString> gradingFeedback3 = solutionGrader.gradeSolution(testSolution3, testProblem3);
     
-    if (gradingFeedback3.startsWith("Error:") || gradingFeedback3.startsWith("Timeout:")) {
-        std::cout << "❌ Grading failed: " << gradingFeedback3.toStdString() << std::endl;
+    if (!gradingFeedback3.ok()) {
+        std::cout << "❌ Grading failed: " << gradingFeedback3.errorString().toStdString() << std::endl;
     } else {
-        std::cout << "🤖 AI Tutor: " << gradingFeedback3.toStdString() << std::endl;
+        std::cout << "🤖 AI Tutor: " << gradingFeedback3.value().toStdString() << std::endl;
         
         // Simulate student asking for clarification
         std::cout << "\n👤 Student: What did I do wrong?" << std::endl;
         std::cout << "🤖 AI Tutor: Getting detailed feedback..." << std::endl;
         
-        QString detailedFeedback3 = solutionGrader.getDetailedFeedback(testSolution3, testProblem3);
-        std::cout << "🤖 AI Tutor: " << detailedFeedback3.toStdString() << std::endl;
+        AiResult<QString> detailedFeedback3 = solutionGrader.getDetailedFeedback(testSolution3, testProblem3);
+        std::cout << "🤖 AI Tutor: " << (detailedFeedback3.ok() ? detailedFeedback3.value() : detailedFeedback3.errorString()).toStdString() << std::endl;
     }
   
   // -----------------------------
@@ -152,7 +179,8 @@ int main(int argc, char *argv[])
 
     // Feed `ocrResult` directly to the AI service or store it in the model
     AIService ai;
-    QString aiResponse = ai.promptSync(ocrResult);
+    AiResult<QString> aiReply = ai.promptSync(ocrResult);
+    QString aiResponse = aiReply.ok() ? aiReply.value() : aiReply.errorString();
 
     std::cout << "\n=== OCR Test ===" << std::endl;
     std::cout << "Extracted Text: " << ocrResult.toStdString() << std::endl;